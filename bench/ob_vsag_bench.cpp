@@ -0,0 +1,444 @@
+#include "../ob_vsag_lib.h"
+#include "nlohmann/json.hpp"
+#include "vsag/allocator.h"
+#include <malloc.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+/*
+ * Sweep index types and parameters over one dataset and print one JSON document:
+ *   ob_vsag_bench [--base file.fvecs|file.bvecs] [--query file] [--groundtruth file.ivecs]
+ *                 [--num 100000] [--dim 128] [--queries 1000] [--seed 47]
+ *                 [--index hnsw,hnsw_sq,hnsw_bq,hgraph] [--metric l2] [--max-degree 16]
+ *                 [--ef-construction 200] [--ef-search 40,80,160] [--topk 10]
+ *                 [--threads 1] [--build-threads 0] [--output result.json]
+ * Without --base, uniform random vectors are generated from --seed. Without
+ * --groundtruth, exact neighbors are computed by obvectorlib::exact_search. Lists are comma
+ * separated, every combination is run. Each build reports its time and the bytes held
+ * by the index allocator, each search config reports recall@topk, QPS and latency
+ * percentiles over all queries. Every --build-threads value builds its own index, the
+ * build_speedup of a run is the build time of the first value divided by its own, so
+ * e.g. --index hnsw --build-threads 1,2,4,8 shows how the build scales with threads.
+ */
+
+typedef std::chrono::steady_clock Clock;
+
+// counts the bytes held by an index
+class CountingAllocator : public vsag::Allocator {
+public:
+    std::string Name() override { return "bench_allocator"; }
+    void* Allocate(size_t size) override {
+        void* p = malloc(size);
+        add(p);
+        return p;
+    }
+    void Deallocate(void* p) override {
+        sub(p);
+        free(p);
+    }
+    void* Reallocate(void* p, size_t size) override {
+        sub(p);
+        void* new_p = realloc(p, size);
+        add(new_p == nullptr ? p : new_p);
+        return new_p;
+    }
+    int64_t used() const { return used_.load(); }
+    int64_t peak() const { return peak_.load(); }
+
+private:
+    void add(void* p) {
+        if (p != nullptr) {
+            int64_t used = used_.fetch_add(malloc_usable_size(p)) + malloc_usable_size(p);
+            int64_t peak = peak_.load();
+            while (used > peak && !peak_.compare_exchange_weak(peak, used)) {}
+        }
+    }
+    void sub(void* p) {
+        if (p != nullptr) {
+            used_.fetch_sub(malloc_usable_size(p));
+        }
+    }
+    std::atomic<int64_t> used_{0};
+    std::atomic<int64_t> peak_{0};
+};
+
+struct Dataset {
+    int dim_ = 0;
+    int64_t num_ = 0;
+    std::vector<float> vectors_;
+};
+
+struct Options {
+    std::string base_path_;
+    std::string query_path_;
+    std::string groundtruth_path_;
+    std::string output_path_;
+    int64_t num_ = 100000;
+    int dim_ = 128;
+    int64_t query_num_ = 1000;
+    int seed_ = 47;
+    std::string metric_ = "l2";
+    std::vector<std::string> index_types_ = {"hnsw", "hnsw_sq", "hnsw_bq", "hgraph"};
+    std::vector<int> max_degrees_ = {16};
+    std::vector<int> ef_constructions_ = {200};
+    std::vector<int> ef_searches_ = {40, 80, 160};
+    std::vector<int> topks_ = {10};
+    std::vector<int> threads_ = {1};
+    std::vector<int> build_threads_ = {0};
+};
+
+static std::vector<std::string> split(const std::string& value)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+static std::vector<int> split_int(const std::string& value)
+{
+    std::vector<int> items;
+    for (const std::string& item : split(value)) {
+        items.push_back(atoi(item.c_str()));
+    }
+    return items;
+}
+
+static bool parse_options(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--base") {
+            options.base_path_ = value;
+        } else if (key == "--query") {
+            options.query_path_ = value;
+        } else if (key == "--groundtruth") {
+            options.groundtruth_path_ = value;
+        } else if (key == "--output") {
+            options.output_path_ = value;
+        } else if (key == "--num") {
+            options.num_ = atoll(value.c_str());
+        } else if (key == "--dim") {
+            options.dim_ = atoi(value.c_str());
+        } else if (key == "--queries") {
+            options.query_num_ = atoll(value.c_str());
+        } else if (key == "--seed") {
+            options.seed_ = atoi(value.c_str());
+        } else if (key == "--metric") {
+            options.metric_ = value;
+        } else if (key == "--index") {
+            options.index_types_ = split(value);
+        } else if (key == "--max-degree") {
+            options.max_degrees_ = split_int(value);
+        } else if (key == "--ef-construction") {
+            options.ef_constructions_ = split_int(value);
+        } else if (key == "--ef-search") {
+            options.ef_searches_ = split_int(value);
+        } else if (key == "--topk") {
+            options.topks_ = split_int(value);
+        } else if (key == "--threads") {
+            options.threads_ = split_int(value);
+        } else if (key == "--build-threads") {
+            options.build_threads_ = split_int(value);
+        } else {
+            std::cerr << "unknown option: " << key << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static obvectorlib::IndexType to_index_type(const std::string& name)
+{
+    if (name == "hnsw") {
+        return obvectorlib::HNSW_TYPE;
+    } else if (name == "hnsw_sq") {
+        return obvectorlib::HNSW_SQ_TYPE;
+    } else if (name == "hnsw_bq") {
+        return obvectorlib::HNSW_BQ_TYPE;
+    } else if (name == "hgraph") {
+        return obvectorlib::HGRAPH_TYPE;
+    }
+    return obvectorlib::INVALID_INDEX_TYPE;
+}
+
+// fvecs rows are an int32 dim followed by dim floats, bvecs rows by dim bytes, at most limit rows are read
+static bool load_vectors(const std::string& path, int64_t limit, Dataset& dataset)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "open fail: " << path << std::endl;
+        return false;
+    }
+    bool is_bvecs = path.size() >= 6 && path.compare(path.size() - 6, 6, ".bvecs") == 0;
+    int32_t dim = 0;
+    std::vector<uint8_t> bytes;
+    while (dataset.num_ < limit && in.read(reinterpret_cast<char*>(&dim), sizeof(dim))) {
+        if (dataset.dim_ != 0 && dim != dataset.dim_) {
+            std::cerr << "inconsistent dim in " << path << std::endl;
+            return false;
+        }
+        dataset.dim_ = dim;
+        size_t offset = dataset.vectors_.size();
+        dataset.vectors_.resize(offset + dim);
+        if (is_bvecs) {
+            bytes.resize(dim);
+            in.read(reinterpret_cast<char*>(bytes.data()), dim);
+            std::copy(bytes.begin(), bytes.end(), dataset.vectors_.begin() + offset);
+        } else {
+            in.read(reinterpret_cast<char*>(dataset.vectors_.data() + offset), dim * sizeof(float));
+        }
+        if (!in) {
+            std::cerr << "truncated file: " << path << std::endl;
+            return false;
+        }
+        dataset.num_++;
+    }
+    return dataset.num_ > 0;
+}
+
+static bool load_groundtruth(const std::string& path, int64_t query_num, int topk,
+                             std::vector<std::vector<int64_t>>& groundtruth)
+{
+    std::ifstream in(path, std::ios::binary);
+    int32_t k = 0;
+    groundtruth.clear();
+    while (static_cast<int64_t>(groundtruth.size()) < query_num && in.read(reinterpret_cast<char*>(&k), sizeof(k))) {
+        std::vector<int32_t> row(k);
+        in.read(reinterpret_cast<char*>(row.data()), k * sizeof(int32_t));
+        if (!in || k < topk) {
+            std::cerr << "groundtruth has less than topk rows: " << path << std::endl;
+            return false;
+        }
+        groundtruth.emplace_back(row.begin(), row.begin() + topk);
+    }
+    return static_cast<int64_t>(groundtruth.size()) == query_num;
+}
+
+static void generate_vectors(std::mt19937& rng, int64_t num, int dim, Dataset& dataset)
+{
+    std::uniform_real_distribution<float> distrib_real;
+    dataset.dim_ = dim;
+    dataset.num_ = num;
+    dataset.vectors_.resize(num * dim);
+    for (float& value : dataset.vectors_) {
+        value = distrib_real(rng);
+    }
+}
+
+// exact topk of every query, ids are row numbers of base
+static int compute_groundtruth(const Dataset& base, const Dataset& query, const std::string& metric, int topk,
+                               int thread_num, std::vector<std::vector<int64_t>>& groundtruth)
+{
+    std::vector<float> dists(query.num_ * topk);
+    std::vector<int64_t> ids(query.num_ * topk);
+    std::vector<int64_t> result_sizes(query.num_);
+    int ret = obvectorlib::exact_search(base.vectors_.data(), nullptr, base.num_, base.dim_, metric.c_str(),
+                                        query.vectors_.data(), query.num_, topk,
+                                        dists.data(), ids.data(), result_sizes.data(), nullptr, false, thread_num);
+    groundtruth.assign(query.num_, std::vector<int64_t>());
+    for (int64_t q = 0; ret == 0 && q < query.num_; ++q) {
+        groundtruth[q].assign(ids.begin() + q * topk, ids.begin() + q * topk + result_sizes[q]);
+    }
+    return ret;
+}
+
+static int64_t percentile(const std::vector<int64_t>& sorted, double p)
+{
+    return sorted.empty() ? 0 : sorted[std::min<size_t>(sorted.size() - 1, static_cast<size_t>(sorted.size() * p))];
+}
+
+static nlohmann::json run_search(obvectorlib::VectorIndexPtr index_handler, const Dataset& query,
+                                 const std::vector<std::vector<int64_t>>& groundtruth,
+                                 int ef_search, int topk, int thread_num)
+{
+    std::vector<int64_t> latencies(query.num_);
+    std::vector<int64_t> hits(query.num_);
+    std::atomic<int64_t> next_query(0);
+    std::atomic<int> first_error(0);
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    for (int t = 0; t < thread_num; ++t) {
+        threads.emplace_back([&]() {
+            std::vector<float> dist(topk);
+            std::vector<int64_t> ids(topk);
+            int64_t result_size = 0;
+            for (int64_t q = next_query.fetch_add(1); q < query.num_; q = next_query.fetch_add(1)) {
+                float* query_vector = const_cast<float*>(query.vectors_.data() + q * query.dim_);
+                auto query_start = Clock::now();
+                int ret = obvectorlib::knn_search_into(index_handler, query_vector, query.dim_, topk,
+                                                       dist.data(), ids.data(), result_size, ef_search,
+                                                       false, nullptr);
+                latencies[q] = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - query_start).count();
+                if (ret != 0) {
+                    first_error.store(ret);
+                    continue;
+                }
+                std::unordered_set<int64_t> expected(groundtruth[q].begin(),
+                                                     groundtruth[q].begin() + std::min<size_t>(topk, groundtruth[q].size()));
+                for (int64_t i = 0; i < result_size; ++i) {
+                    hits[q] += expected.count(ids[i]);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    int64_t hit_count = 0;
+    for (int64_t hit : hits) {
+        hit_count += hit;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    nlohmann::json result;
+    result["ef_search"] = ef_search;
+    result["topk"] = topk;
+    result["threads"] = thread_num;
+    result["ret"] = first_error.load();
+    result["recall"] = query.num_ == 0 ? 0.0 : static_cast<double>(hit_count) / (query.num_ * topk);
+    result["qps"] = seconds > 0 ? query.num_ / seconds : 0.0;
+    result["latency_us"] = {{"p50", percentile(latencies, 0.5)},
+                            {"p99", percentile(latencies, 0.99)},
+                            {"p999", percentile(latencies, 0.999)},
+                            {"max", latencies.empty() ? 0 : latencies.back()}};
+    return result;
+}
+
+int
+main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        return 1;
+    }
+    obvectorlib::is_init();
+    obvectorlib::set_log_level(0);
+
+    std::mt19937 rng(options.seed_);
+    Dataset base;
+    Dataset query;
+    if (!options.base_path_.empty()) {
+        if (!load_vectors(options.base_path_, options.num_, base)) {
+            return 1;
+        }
+    } else {
+        generate_vectors(rng, options.num_, options.dim_, base);
+    }
+    if (!options.query_path_.empty()) {
+        if (!load_vectors(options.query_path_, options.query_num_, query) || query.dim_ != base.dim_) {
+            std::cerr << "invalid query file: " << options.query_path_ << std::endl;
+            return 1;
+        }
+    } else {
+        generate_vectors(rng, options.query_num_, base.dim_, query);
+    }
+    int max_topk = *std::max_element(options.topks_.begin(), options.topks_.end());
+    int hardware_threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+    std::vector<std::vector<int64_t>> groundtruth;
+    auto gt_start = Clock::now();
+    if (!options.groundtruth_path_.empty()) {
+        if (!load_groundtruth(options.groundtruth_path_, query.num_, max_topk, groundtruth)) {
+            return 1;
+        }
+    } else if (compute_groundtruth(base, query, options.metric_, max_topk, hardware_threads, groundtruth) != 0) {
+        std::cerr << "compute groundtruth fail, metric: " << options.metric_ << std::endl;
+        return 1;
+    }
+    double gt_seconds = std::chrono::duration<double>(Clock::now() - gt_start).count();
+    std::vector<int64_t> ids(base.num_);
+    for (int64_t i = 0; i < base.num_; ++i) {
+        ids[i] = i;
+    }
+
+    nlohmann::json report;
+    report["dataset"] = {{"base", options.base_path_.empty() ? "random" : options.base_path_},
+                         {"query", options.query_path_.empty() ? "random" : options.query_path_},
+                         {"num", base.num_},
+                         {"dim", base.dim_},
+                         {"queries", query.num_},
+                         {"metric", options.metric_},
+                         {"seed", options.seed_},
+                         {"groundtruth_seconds", gt_seconds}};
+    report["runs"] = nlohmann::json::array();
+    int failed = 0;
+    for (const std::string& index_name : options.index_types_) {
+        obvectorlib::IndexType index_type = to_index_type(index_name);
+        for (int max_degree : options.max_degrees_) {
+            for (int ef_construction : options.ef_constructions_) {
+                double first_build_seconds = 0;
+                for (int build_threads : options.build_threads_) {
+                    nlohmann::json run;
+                    run["index"] = index_name;
+                    run["max_degree"] = max_degree;
+                    run["ef_construction"] = ef_construction;
+                    run["build_threads"] = build_threads;
+                    CountingAllocator allocator;
+                    obvectorlib::VectorIndexPtr index_handler = NULL;
+                    int ret = obvectorlib::create_index(index_handler, index_type, "float32", options.metric_.c_str(),
+                                                        base.dim_, max_degree, ef_construction, options.ef_searches_[0],
+                                                        &allocator, 0, build_threads);
+                    auto build_start = Clock::now();
+                    if (ret == 0) {
+                        ret = obvectorlib::build_index(index_handler, base.vectors_.data(), ids.data(), base.dim_, base.num_);
+                    }
+                    double build_seconds = std::chrono::duration<double>(Clock::now() - build_start).count();
+                    if (first_build_seconds == 0) {
+                        first_build_seconds = build_seconds;
+                    }
+                    run["build_seconds"] = build_seconds;
+                    run["build_speedup"] = build_seconds > 0 ? first_build_seconds / build_seconds : 0.0;
+                    run["ret"] = ret;
+                    if (ret != 0) {
+                        failed++;
+                        std::cerr << "build " << index_name << " fail, ret=" << ret << std::endl;
+                        obvectorlib::delete_index(index_handler);
+                        report["runs"].push_back(run);
+                        continue;
+                    }
+                    int64_t index_size = 0;
+                    obvectorlib::get_index_number(index_handler, index_size);
+                    run["index_size"] = index_size;
+                    run["memory_bytes"] = allocator.used();
+                    run["peak_memory_bytes"] = allocator.peak();
+                    run["searches"] = nlohmann::json::array();
+                    for (int ef_search : options.ef_searches_) {
+                        for (int topk : options.topks_) {
+                            for (int thread_num : options.threads_) {
+                                nlohmann::json search = run_search(index_handler, query, groundtruth, ef_search,
+                                                                   topk, std::max(thread_num, 1));
+                                failed += search["ret"].get<int>() != 0;
+                                run["searches"].push_back(search);
+                            }
+                        }
+                    }
+                    obvectorlib::delete_index(index_handler);
+                    report["runs"].push_back(run);
+                }
+            }
+        }
+    }
+
+    if (options.output_path_.empty()) {
+        std::cout << report.dump(2) << std::endl;
+    } else {
+        std::ofstream out(options.output_path_);
+        out << report.dump(2) << std::endl;
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -5,6 +5,16 @@
 #include "vsag/options.h"
 #include "fmt/format.h"
 
+#include <atomic>
+
+/*
+ * Messages below OB_VSAG_LOG_MIN_LEVEL (a vsag::Logger::Level value) are compiled out of
+ * the OB_VSAG_LOG_* macros, e.g. -DOB_VSAG_LOG_MIN_LEVEL=2 drops trace and debug logs.
+ */
+#ifndef OB_VSAG_LOG_MIN_LEVEL
+#define OB_VSAG_LOG_MIN_LEVEL 0
+#endif
+
 namespace vsag {
 namespace logger {
 
@@ -43,77 +53,129 @@ public:
 };
 
 
+// copy of the level set through set_level, checked before a message is formatted, starts
+// at the info level of the default vsag logger
+inline std::atomic<int> cached_level{Logger::Level::kINFO};
+
+inline bool
+should_log(level log_level) {
+    return static_cast<int>(log_level) >= OB_VSAG_LOG_MIN_LEVEL
+           && static_cast<int>(log_level) >= cached_level.load(std::memory_order_relaxed);
+}
+
 inline void
 set_level(level log_level) {
+    cached_level.store(static_cast<int>(log_level), std::memory_order_relaxed);
     Options::Instance().logger()->SetLevel((Logger::Level)log_level);
 }
 
+inline level
+get_level() {
+    return static_cast<level>(cached_level.load(std::memory_order_relaxed));
+}
+
 inline void
 trace(const std::string& msg) {
-    Options::Instance().logger()->Trace(msg);
+    if (should_log(level::trace)) {
+        Options::Instance().logger()->Trace(msg);
+    }
 }
 
 inline void
 debug(const std::string& msg) {
-    Options::Instance().logger()->Debug(msg);
+    if (should_log(level::debug)) {
+        Options::Instance().logger()->Debug(msg);
+    }
 }
 
 inline void
 info(const std::string& msg) {
-    Options::Instance().logger()->Info(msg);
+    if (should_log(level::info)) {
+        Options::Instance().logger()->Info(msg);
+    }
 }
 
 inline void
 warn(const std::string& msg) {
-    Options::Instance().logger()->Warn(msg);
+    if (should_log(level::warn)) {
+        Options::Instance().logger()->Warn(msg);
+    }
 }
 
 inline void
 error(const std::string& msg) {
-    Options::Instance().logger()->Error(msg);
+    if (should_log(level::err)) {
+        Options::Instance().logger()->Error(msg);
+    }
 }
 
 inline void
 critical(const std::string& msg) {
-    Options::Instance().logger()->Critical(msg);
+    if (should_log(level::critical)) {
+        Options::Instance().logger()->Critical(msg);
+    }
 }
 
 template <typename... Args>
 inline void
 trace(fmt::format_string<Args...> fmt, Args&&... args) {
-    trace(fmt::format(fmt, std::forward<Args>(args)...));
+    if (should_log(level::trace)) {
+        Options::Instance().logger()->Trace(fmt::format(fmt, std::forward<Args>(args)...));
+    }
 }
 
 template <typename... Args>
 inline void
 debug(fmt::format_string<Args...> fmt, Args&&... args) {
-    debug(fmt::format(fmt, std::forward<Args>(args)...));
+    if (should_log(level::debug)) {
+        Options::Instance().logger()->Debug(fmt::format(fmt, std::forward<Args>(args)...));
+    }
 }
 
 template <typename... Args>
 inline void
 info(fmt::format_string<Args...> fmt, Args&&... args) {
-    info(fmt::format(fmt, std::forward<Args>(args)...));
+    if (should_log(level::info)) {
+        Options::Instance().logger()->Info(fmt::format(fmt, std::forward<Args>(args)...));
+    }
 }
 
 template <typename... Args>
 inline void
 warn(fmt::format_string<Args...> fmt, Args&&... args) {
-    warn(fmt::format(fmt, std::forward<Args>(args)...));
+    if (should_log(level::warn)) {
+        Options::Instance().logger()->Warn(fmt::format(fmt, std::forward<Args>(args)...));
+    }
 }
 
 template <typename... Args>
 inline void
 error(fmt::format_string<Args...> fmt, Args&&... args) {
-    error(fmt::format(fmt, std::forward<Args>(args)...));
+    if (should_log(level::err)) {
+        Options::Instance().logger()->Error(fmt::format(fmt, std::forward<Args>(args)...));
+    }
 }
 
 template <typename... Args>
 inline void
 critical(fmt::format_string<Args...> fmt, Args&&... args) {
-    critical(fmt::format(fmt, std::forward<Args>(args)...));
+    if (should_log(level::critical)) {
+        Options::Instance().logger()->Critical(fmt::format(fmt, std::forward<Args>(args)...));
+    }
 }
 
 }  // namespace logger
 }  // namespace vsag
+
+// unlike the functions above, the macros do not evaluate their arguments when the level is off
+#define OB_VSAG_LOG(log_level, func, ...)                      \
+    do {                                                       \
+        if (vsag::logger::should_log(log_level)) {             \
+            func(__VA_ARGS__);                                 \
+        }                                                      \
+    } while (0)
+#define OB_VSAG_LOG_TRACE(...) OB_VSAG_LOG(vsag::logger::level::trace, vsag::logger::trace, __VA_ARGS__)
+#define OB_VSAG_LOG_DEBUG(...) OB_VSAG_LOG(vsag::logger::level::debug, vsag::logger::debug, __VA_ARGS__)
+#define OB_VSAG_LOG_INFO(...) OB_VSAG_LOG(vsag::logger::level::info, vsag::logger::info, __VA_ARGS__)
+#define OB_VSAG_LOG_WARN(...) OB_VSAG_LOG(vsag::logger::level::warn, vsag::logger::warn, __VA_ARGS__)
 #endif //DEFAULT_LOGGER_H
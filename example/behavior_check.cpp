@@ -0,0 +1,463 @@
+#include "../ob_vsag_lib.h"
+#include "default_allocator.h"
+#include "roaring/roaring64.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+/*
+ * Behavior checks of the index handler API, run by ctest:
+ *   behavior_check
+ * Each check prints its name and the first mismatch it finds, the exit code is the
+ * number of failed checks.
+ */
+
+static const int DIM = 32;
+static const int BASE_NUM = 2000;
+static const int TOPK = 10;
+static const int EF_SEARCH = 200;
+
+#define CHECK(cond)                                                                      \
+    do {                                                                                 \
+        if (!(cond)) {                                                                   \
+            std::cout << "  check fail at line " << __LINE__ << ": " #cond << std::endl; \
+            return 1;                                                                    \
+        }                                                                                \
+    } while (0)
+
+static void make_vectors(std::mt19937& rng, float* vectors, int64_t count)
+{
+    std::uniform_real_distribution<> distrib_real;
+    for (int64_t i = 0; i < count * DIM; ++i) {
+        vectors[i] = distrib_real(rng);
+    }
+}
+
+// hnsw index of BASE_NUM random rows with ids 0..BASE_NUM-1
+static int create_base_index(DefaultAllocator& allocator, const char* metric, std::vector<float>& base,
+                             std::vector<int64_t>& base_ids, obvectorlib::VectorIndexPtr& index_handler)
+{
+    std::mt19937 rng(47);
+    base.resize(static_cast<int64_t>(BASE_NUM) * DIM);
+    base_ids.resize(BASE_NUM);
+    make_vectors(rng, base.data(), BASE_NUM);
+    for (int64_t i = 0; i < BASE_NUM; ++i) {
+        base_ids[i] = i;
+    }
+    int ret = obvectorlib::create_index(index_handler, obvectorlib::HNSW_TYPE, "float32", metric, DIM,
+                                        16, 100, EF_SEARCH, &allocator);
+    if (ret == 0) {
+        ret = obvectorlib::build_index(index_handler, base.data(), base_ids.data(), DIM, BASE_NUM);
+    }
+    return ret;
+}
+
+static bool contains(const int64_t* ids, int64_t size, int64_t id)
+{
+    for (int64_t i = 0; i < size; ++i) {
+        if (ids[i] == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// removed rows leave the results right away, after the background repair and through a save/load
+static int check_remove()
+{
+    DefaultAllocator allocator;
+    obvectorlib::VectorIndexPtr index_handler = NULL;
+    std::vector<float> base;
+    std::vector<int64_t> base_ids;
+    CHECK(create_base_index(allocator, "l2", base, base_ids, index_handler) == 0);
+    const int64_t removed[] = {5, 17, 100};
+    float dist[TOPK];
+    int64_t ids[TOPK];
+    int64_t result_size = 0;
+    CHECK(obvectorlib::remove_index(index_handler, removed, 3) == 0);
+    for (int64_t id : removed) {
+        CHECK(obvectorlib::knn_search_into(index_handler, base.data() + id * DIM, DIM, TOPK, dist, ids,
+                                           result_size, EF_SEARCH, false, nullptr) == 0);
+        CHECK(result_size == TOPK && !contains(ids, result_size, id));
+    }
+    // the repair task removes the rows from the graph, rows it cannot remove stay masked
+    int64_t size = 0;
+    for (int i = 0; i < 200 && obvectorlib::get_index_number(index_handler, size) == 0 && size != BASE_NUM - 3; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::cout << "  index size after repair: " << size << std::endl;
+    CHECK(obvectorlib::knn_search_into(index_handler, base.data() + 5 * DIM, DIM, TOPK, dist, ids,
+                                       result_size, EF_SEARCH, false, nullptr) == 0);
+    CHECK(!contains(ids, result_size, 5));
+
+    std::stringstream stream;
+    CHECK(obvectorlib::fserialize(index_handler, stream) == 0);
+    obvectorlib::VectorIndexPtr loaded_handler = NULL;
+    CHECK(obvectorlib::create_index(loaded_handler, obvectorlib::HNSW_TYPE, "float32", "l2", DIM,
+                                    16, 100, EF_SEARCH, &allocator) == 0);
+    CHECK(obvectorlib::fdeserialize(loaded_handler, stream) == 0);
+    for (int64_t id : removed) {
+        CHECK(obvectorlib::knn_search_into(loaded_handler, base.data() + id * DIM, DIM, TOPK, dist, ids,
+                                           result_size, EF_SEARCH, false, nullptr) == 0);
+        CHECK(result_size == TOPK && !contains(ids, result_size, id));
+    }
+    CHECK(obvectorlib::knn_search_into(loaded_handler, base.data() + 6 * DIM, DIM, 1, dist, ids,
+                                       result_size, EF_SEARCH, false, nullptr) == 0);
+    CHECK(result_size == 1 && ids[0] == 6);
+    // adding a removed id again makes it visible again
+    int64_t readded_id = 17;
+    CHECK(obvectorlib::add_index(loaded_handler, base.data() + readded_id * DIM, &readded_id, DIM, 1) == 0);
+    CHECK(obvectorlib::knn_search_into(loaded_handler, base.data() + readded_id * DIM, DIM, 1, dist, ids,
+                                       result_size, EF_SEARCH, false, nullptr) == 0);
+    CHECK(result_size == 1 && ids[0] == readded_id);
+    obvectorlib::delete_index(loaded_handler);
+    obvectorlib::delete_index(index_handler);
+    return 0;
+}
+
+// an updated row is found, and measured, at its new vector, with its new extra info
+static int check_update()
+{
+    DefaultAllocator allocator;
+    obvectorlib::VectorIndexPtr index_handler = NULL;
+    std::vector<float> base;
+    std::vector<int64_t> base_ids;
+    CHECK(create_base_index(allocator, "l2", base, base_ids, index_handler) == 0);
+    std::vector<float> query(base.begin(), base.begin() + DIM);
+    int64_t updated_id = 0;
+    const float* distances = nullptr;
+    CHECK(obvectorlib::cal_distance_by_id(index_handler, query.data(), &updated_id, 1, distances) == 0);
+    const bool found = distances[0] < 1e-5;
+    // distances are allocated by the allocator of the index and owned by the caller
+    allocator.Deallocate(const_cast<float*>(distances));
+    CHECK(found);
+    // move row 0 by 1 on every dimension, its squared l2 distance to the old vector is DIM
+    std::vector<float> moved(query);
+    for (float& value : moved) {
+        value += 1;
+    }
+    CHECK(obvectorlib::update_index(index_handler, moved.data(), &updated_id, DIM, 1) == 0);
+    CHECK(obvectorlib::cal_distance_by_id(index_handler, query.data(), &updated_id, 1, distances) == 0);
+    const bool moved_away = std::abs(distances[0] - DIM) < 1e-3;
+    allocator.Deallocate(const_cast<float*>(distances));
+    CHECK(moved_away);
+    float dist[1];
+    int64_t ids[1];
+    int64_t result_size = 0;
+    CHECK(obvectorlib::knn_search_into(index_handler, moved.data(), DIM, 1, dist, ids, result_size,
+                                       EF_SEARCH, false, nullptr) == 0);
+    CHECK(result_size == 1 && ids[0] == updated_id && dist[0] < 1e-5);
+    obvectorlib::delete_index(index_handler);
+
+    // an update with extra infos removes the row and adds it again with both replaced
+    const int extra_info_size = 8;
+    obvectorlib::VectorIndexPtr extra_handler = NULL;
+    CHECK(obvectorlib::create_index(extra_handler, obvectorlib::HGRAPH_TYPE, "float32", "l2", DIM,
+                                    16, 100, EF_SEARCH, &allocator, extra_info_size) == 0);
+    std::vector<char> extra_infos(static_cast<int64_t>(BASE_NUM) * extra_info_size, 'a');
+    CHECK(obvectorlib::build_index(extra_handler, base.data(), base_ids.data(), DIM, BASE_NUM,
+                                   extra_infos.data()) == 0);
+    std::vector<char> new_extra_info(extra_info_size, 'b');
+    CHECK(obvectorlib::update_index(extra_handler, moved.data(), &updated_id, DIM, 1, new_extra_info.data()) == 0);
+    std::vector<char> stored_extra_info(extra_info_size);
+    CHECK(obvectorlib::get_extra_info_by_ids(extra_handler, &updated_id, 1, stored_extra_info.data()) == 0);
+    CHECK(stored_extra_info == new_extra_info);
+    CHECK(obvectorlib::knn_search_into(extra_handler, moved.data(), DIM, 1, dist, ids, result_size,
+                                       EF_SEARCH, false, nullptr) == 0);
+    CHECK(result_size == 1 && ids[0] == updated_id && dist[0] < 1e-5);
+    obvectorlib::delete_index(extra_handler);
+    return 0;
+}
+
+/*
+ * Searches running during concurrent add_index calls only see written rows, by ascending
+ * distance, a written row is found by the next search of its vector and the index ends up
+ * with every row.
+ */
+static int check_concurrent_add()
+{
+    const int writer_num = 2;
+    const int reader_num = 4;
+    const int batch_num = 10;
+    const int batch_size = 200;
+    DefaultAllocator allocator;
+    obvectorlib::VectorIndexPtr index_handler = NULL;
+    std::vector<float> base;
+    std::vector<int64_t> base_ids;
+    CHECK(create_base_index(allocator, "l2", base, base_ids, index_handler) == 0);
+    std::atomic<bool> stop(false);
+    std::atomic<int64_t> next_id(BASE_NUM);
+    std::atomic<int64_t> bad_results(0);
+    std::atomic<int64_t> not_found(0);
+    std::atomic<int> first_error(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < reader_num; ++t) {
+        readers.emplace_back([&, t]() {
+            std::mt19937 rng(t);
+            float dist[TOPK];
+            int64_t ids[TOPK];
+            int64_t result_size = 0;
+            while (!stop.load()) {
+                float* query = base.data() + static_cast<int64_t>(rng() % BASE_NUM) * DIM;
+                int ret = obvectorlib::knn_search_into(index_handler, query, DIM, TOPK, dist, ids, result_size,
+                                                       EF_SEARCH, false, nullptr);
+                const int64_t max_id = next_id.load();
+                if (ret != 0) {
+                    first_error.store(ret);
+                } else if (result_size != TOPK) {
+                    bad_results.fetch_add(1);
+                }
+                for (int64_t i = 0; ret == 0 && i < result_size; ++i) {
+                    if (ids[i] < 0 || ids[i] >= max_id || (i > 0 && dist[i] < dist[i - 1])) {
+                        bad_results.fetch_add(1);
+                        break;
+                    }
+                }
+            }
+        });
+    }
+    std::vector<std::thread> writers;
+    for (int t = 0; t < writer_num; ++t) {
+        writers.emplace_back([&, t]() {
+            std::mt19937 rng(1000 + t);
+            std::vector<float> vectors(static_cast<int64_t>(batch_size) * DIM);
+            std::vector<int64_t> ids(batch_size);
+            float dist[1];
+            int64_t result_id[1];
+            int64_t result_size = 0;
+            for (int batch = 0; batch < batch_num && first_error.load() == 0; ++batch) {
+                make_vectors(rng, vectors.data(), batch_size);
+                // ids are taken before the rows are written, readers may see an id up to next_id
+                const int64_t start_id = next_id.fetch_add(batch_size);
+                for (int64_t i = 0; i < batch_size; ++i) {
+                    ids[i] = start_id + i;
+                }
+                int ret = obvectorlib::add_index(index_handler, vectors.data(), ids.data(), DIM, batch_size);
+                if (ret != 0) {
+                    first_error.store(ret);
+                    break;
+                }
+                for (int64_t i = 0; i < batch_size; ++i) {
+                    obvectorlib::knn_search_into(index_handler, vectors.data() + i * DIM, DIM, 1, dist, result_id,
+                                                 result_size, EF_SEARCH, false, nullptr);
+                    if (result_size != 1 || result_id[0] != ids[i]) {
+                        not_found.fetch_add(1);
+                    }
+                }
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    stop.store(true);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    int64_t size = 0;
+    CHECK(obvectorlib::get_index_number(index_handler, size) == 0);
+    std::cout << "  index size: " << size << ", not found after add: " << not_found.load() << std::endl;
+    CHECK(first_error.load() == 0);
+    CHECK(bad_results.load() == 0);
+    CHECK(size == BASE_NUM + writer_num * batch_num * batch_size);
+    // graph search may rarely miss a row, a row missing from the index misses every time
+    CHECK(not_found.load() <= writer_num * batch_num * batch_size / 100);
+    obvectorlib::delete_index(index_handler);
+    return 0;
+}
+
+// the results of a filter keeping few rows are those of a brute force scan of the kept rows
+static int check_selective_filter()
+{
+    const int kept_num = 50;
+    DefaultAllocator allocator;
+    obvectorlib::VectorIndexPtr index_handler = NULL;
+    std::vector<float> base;
+    std::vector<int64_t> base_ids;
+    CHECK(create_base_index(allocator, "l2", base, base_ids, index_handler) == 0);
+    roaring::api::roaring64_bitmap_t* kept = roaring::api::roaring64_bitmap_create();
+    for (int64_t i = 0; i < kept_num; ++i) {
+        roaring::api::roaring64_bitmap_add(kept, i * 37 % BASE_NUM);
+    }
+    // reverse_filter keeps only the ids of the bitmap, few enough for the planner to scan them
+    obvectorlib::RoaringFilter filter(kept);
+    std::mt19937 rng(7);
+    std::vector<float> query(DIM);
+    make_vectors(rng, query.data(), 1);
+    std::vector<std::pair<float, int64_t>> expected;
+    for (int64_t i = 0; i < kept_num; ++i) {
+        const int64_t id = i * 37 % BASE_NUM;
+        float distance = 0;
+        for (int d = 0; d < DIM; ++d) {
+            const float diff = base[id * DIM + d] - query[d];
+            distance += diff * diff;
+        }
+        expected.emplace_back(distance, id);
+    }
+    std::sort(expected.begin(), expected.end());
+    float dist[TOPK];
+    int64_t ids[TOPK];
+    int64_t result_size = 0;
+    int ret = obvectorlib::knn_search_into(index_handler, query.data(), DIM, TOPK, dist, ids, result_size,
+                                           EF_SEARCH, false, nullptr, &filter, true);
+    const float* result_dist = nullptr;
+    const int64_t* result_ids = nullptr;
+    int64_t allocated_size = 0;
+    const char* extra_infos = nullptr;
+    int allocated_ret = obvectorlib::knn_search(index_handler, query.data(), DIM, TOPK, result_dist, result_ids,
+                                                allocated_size, EF_SEARCH, false, extra_infos, &filter, true);
+    bool same = ret == 0 && allocated_ret == 0 && result_size == TOPK && allocated_size == TOPK;
+    for (int64_t i = 0; same && i < TOPK; ++i) {
+        same = ids[i] == expected[i].second && result_ids[i] == expected[i].second
+               && std::abs(dist[i] - expected[i].first) < 1e-4 && std::abs(result_dist[i] - expected[i].first) < 1e-4;
+    }
+    // results of knn_search are allocated by the allocator of the index and owned by the caller
+    if (allocated_ret == 0) {
+        allocator.Deallocate(const_cast<float*>(result_dist));
+        allocator.Deallocate(const_cast<int64_t*>(result_ids));
+    }
+    roaring::api::roaring64_bitmap_free(kept);
+    CHECK(same);
+    obvectorlib::delete_index(index_handler);
+    return 0;
+}
+
+// the ingest stage drops rows holding NaN or Inf or without a norm, and an update with
+// such a row fails without replacing anything
+static int check_ingest()
+{
+    DefaultAllocator allocator;
+    // normalizing changes l2 and ip distances
+    for (const char* metric : {"l2", "ip"}) {
+        obvectorlib::VectorIndexPtr norm_handler = NULL;
+        CHECK(obvectorlib::create_index(norm_handler, obvectorlib::HNSW_TYPE, "float32", metric, DIM,
+                                        16, 100, EF_SEARCH, &allocator) == 0);
+        CHECK(obvectorlib::set_ingest_options(norm_handler, obvectorlib::INGEST_NORMALIZE) != 0);
+        CHECK(obvectorlib::set_ingest_options(norm_handler, obvectorlib::INGEST_VALIDATE) == 0);
+        obvectorlib::delete_index(norm_handler);
+    }
+
+    obvectorlib::VectorIndexPtr index_handler = NULL;
+    CHECK(obvectorlib::create_index(index_handler, obvectorlib::HNSW_TYPE, "float32", "cosine", DIM,
+                                    16, 100, EF_SEARCH, &allocator) == 0);
+    CHECK(obvectorlib::set_ingest_options(index_handler,
+                                          obvectorlib::INGEST_VALIDATE | obvectorlib::INGEST_NORMALIZE) == 0);
+    std::mt19937 rng(47);
+    std::vector<float> base(static_cast<int64_t>(BASE_NUM) * DIM);
+    std::vector<int64_t> base_ids(BASE_NUM);
+    make_vectors(rng, base.data(), BASE_NUM);
+    for (int64_t i = 0; i < BASE_NUM; ++i) {
+        base_ids[i] = i;
+    }
+    base[3 * DIM + 1] = std::nanf("");
+    base[7 * DIM] = std::numeric_limits<float>::infinity();
+    std::fill(base.begin() + 9 * DIM, base.begin() + 10 * DIM, 0.0f);
+    const std::vector<float> written(base);
+    int64_t rejected_count = 0;
+    CHECK(obvectorlib::build_index(index_handler, base.data(), obvectorlib::FLOAT32_VECTOR, base_ids.data(), DIM,
+                                   BASE_NUM, nullptr, -1, &rejected_count) == 0);
+    CHECK(rejected_count == 3);
+    int64_t size = 0;
+    CHECK(obvectorlib::get_index_number(index_handler, size) == 0);
+    CHECK(size == BASE_NUM - 3);
+    obvectorlib::IndexStats stats;
+    CHECK(obvectorlib::get_index_stats(index_handler, stats) == 0);
+    CHECK(stats.rejected_row_count_ == 3);
+    // the caller rows are left as written
+    CHECK(std::equal(base.begin(), base.begin() + 3 * DIM, written.begin()));
+    // a stored row is at cosine distance 0 of its own direction, whatever the norm of the query
+    auto distance_of = [&](int64_t id, const std::vector<float>& vector, float& distance) {
+        const float* distances = nullptr;
+        if (obvectorlib::cal_distance_by_id(index_handler, const_cast<float*>(vector.data()), &id, 1, distances) != 0) {
+            return false;
+        }
+        distance = distances[0];
+        allocator.Deallocate(const_cast<float*>(distances));
+        return true;
+    };
+    for (int64_t id : {0, 1, 1999}) {
+        std::vector<float> scaled(base.begin() + id * DIM, base.begin() + (id + 1) * DIM);
+        for (float& value : scaled) {
+            value *= 2;
+        }
+        float distance = 1;
+        CHECK(distance_of(id, scaled, distance) && std::abs(distance) < 1e-4);
+    }
+    // an update holding a NaN row is rejected as a whole, the valid row next to it included
+    std::vector<float> update(2 * DIM);
+    int64_t update_ids[2] = {0, 1};
+    make_vectors(rng, update.data(), 2);
+    update[DIM + 2] = std::nanf("");
+    CHECK(obvectorlib::update_index(index_handler, update.data(), update_ids, DIM, 2) != 0);
+    for (int64_t id : {0, 1}) {
+        const std::vector<float> row(base.begin() + id * DIM, base.begin() + (id + 1) * DIM);
+        float distance = 1;
+        CHECK(distance_of(id, row, distance) && std::abs(distance) < 1e-4);
+    }
+    // a valid update goes through the same stage and replaces the row
+    CHECK(obvectorlib::update_index(index_handler, update.data(), update_ids, DIM, 1) == 0);
+    const std::vector<float> updated(update.begin(), update.begin() + DIM);
+    float distance = 1;
+    CHECK(distance_of(0, updated, distance) && std::abs(distance) < 1e-4);
+    obvectorlib::delete_index(index_handler);
+    return 0;
+}
+
+// rows removed before a swap stay removed in the index they were removed from
+static int check_swap()
+{
+    DefaultAllocator allocator;
+    obvectorlib::VectorIndexPtr index_handler = NULL;
+    obvectorlib::VectorIndexPtr new_index_handler = NULL;
+    std::vector<float> base;
+    std::vector<int64_t> base_ids;
+    CHECK(create_base_index(allocator, "l2", base, base_ids, index_handler) == 0);
+    CHECK(create_base_index(allocator, "l2", base, base_ids, new_index_handler) == 0);
+    const int64_t removed = 5;
+    CHECK(obvectorlib::remove_index(index_handler, &removed, 1) == 0);
+    CHECK(obvectorlib::swap_index(index_handler, new_index_handler) == 0);
+    float dist[TOPK];
+    int64_t ids[TOPK];
+    int64_t result_size = 0;
+    CHECK(obvectorlib::knn_search_into(index_handler, base.data() + removed * DIM, DIM, 1, dist, ids,
+                                       result_size, EF_SEARCH, false, nullptr) == 0);
+    CHECK(result_size == 1 && ids[0] == removed);
+    CHECK(obvectorlib::knn_search_into(new_index_handler, base.data() + removed * DIM, DIM, TOPK, dist, ids,
+                                       result_size, EF_SEARCH, false, nullptr) == 0);
+    CHECK(result_size == TOPK && !contains(ids, result_size, removed));
+    obvectorlib::delete_index(new_index_handler);
+    obvectorlib::delete_index(index_handler);
+    return 0;
+}
+
+int
+main() {
+    obvectorlib::is_init();
+    struct {
+        const char* name_;
+        int (*check_)();
+    } checks[] = {
+        {"remove", check_remove},
+        {"update", check_update},
+        {"concurrent_add", check_concurrent_add},
+        {"selective_filter", check_selective_filter},
+        {"ingest", check_ingest},
+        {"swap", check_swap},
+    };
+    int fail_count = 0;
+    for (auto& check : checks) {
+        std::cout << "check " << check.name_ << std::endl;
+        if (check.check_() != 0) {
+            ++fail_count;
+        }
+    }
+    std::cout << (fail_count == 0 ? "all checks passed" : "some checks failed") << std::endl;
+    return fail_count;
+}
@@ -0,0 +1,146 @@
+#include "../ob_vsag_lib.h"
+#include "default_allocator.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+
+/*
+ * Stress of one index handler shared by search and insert threads:
+ *   concurrent_stress [index_type] [reader_threads] [writer_threads] [seconds]
+ * Readers search random base vectors, writers insert batches and check that every row of
+ * a batch is found by a search started after add_index returned. Prints the search
+ * latency percentiles and the number of sampled rows not found after their insert,
+ * which counts rare recall misses of the graph search too.
+ */
+
+static const int DIM = 128;
+static const int BASE_NUM = 20000;
+static const int BATCH_SIZE = 1000;
+static const int TOPK = 10;
+static const int EF_SEARCH = 100;
+
+static void make_vectors(std::mt19937& rng, float* vectors, int64_t count)
+{
+    std::uniform_real_distribution<> distrib_real;
+    for (int64_t i = 0; i < count * DIM; ++i) {
+        vectors[i] = distrib_real(rng);
+    }
+}
+
+int
+main(int argc, char** argv) {
+    obvectorlib::IndexType index_type = argc > 1 ? static_cast<obvectorlib::IndexType>(atoi(argv[1]))
+                                                 : obvectorlib::HNSW_TYPE;
+    int reader_num = argc > 2 ? atoi(argv[2]) : 8;
+    int writer_num = argc > 3 ? atoi(argv[3]) : 2;
+    int seconds = argc > 4 ? atoi(argv[4]) : 10;
+    obvectorlib::is_init();
+
+    DefaultAllocator default_allocator;
+    obvectorlib::VectorIndexPtr index_handler = NULL;
+    int ret = obvectorlib::create_index(index_handler, index_type, "float32", "l2", DIM,
+                                        16, 100, EF_SEARCH, &default_allocator);
+    if (ret != 0) {
+        std::cout << "create index fail, ret=" << ret << std::endl;
+        return 1;
+    }
+    std::mt19937 rng(47);
+    std::vector<float> base(static_cast<int64_t>(BASE_NUM) * DIM);
+    std::vector<int64_t> base_ids(BASE_NUM);
+    make_vectors(rng, base.data(), BASE_NUM);
+    for (int64_t i = 0; i < BASE_NUM; ++i) {
+        base_ids[i] = i;
+    }
+    if ((ret = obvectorlib::build_index(index_handler, base.data(), base_ids.data(), DIM, BASE_NUM)) != 0) {
+        std::cout << "build index fail, ret=" << ret << std::endl;
+        return 1;
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<int64_t> next_id(BASE_NUM);
+    std::atomic<int64_t> inserted(0);
+    std::atomic<int64_t> invisible(0);
+    std::atomic<int> first_error(0);
+    std::vector<std::vector<int64_t>> latencies(reader_num);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < reader_num; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 reader_rng(t);
+            float dist[TOPK];
+            int64_t ids[TOPK];
+            int64_t result_size = 0;
+            while (!stop.load()) {
+                float* query = base.data() + static_cast<int64_t>(reader_rng() % BASE_NUM) * DIM;
+                auto start = std::chrono::steady_clock::now();
+                int search_ret = obvectorlib::knn_search_into(index_handler, query, DIM, TOPK, dist, ids,
+                                                              result_size, EF_SEARCH, false, nullptr);
+                auto end = std::chrono::steady_clock::now();
+                if (search_ret != 0) {
+                    first_error.store(search_ret);
+                }
+                latencies[t].push_back(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+            }
+        });
+    }
+    for (int t = 0; t < writer_num; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 writer_rng(1000 + t);
+            std::vector<float> vectors(static_cast<int64_t>(BATCH_SIZE) * DIM);
+            std::vector<int64_t> ids(BATCH_SIZE);
+            float dist[1];
+            int64_t result_id[1];
+            int64_t result_size = 0;
+            while (!stop.load()) {
+                make_vectors(writer_rng, vectors.data(), BATCH_SIZE);
+                int64_t start_id = next_id.fetch_add(BATCH_SIZE);
+                for (int64_t i = 0; i < BATCH_SIZE; ++i) {
+                    ids[i] = start_id + i;
+                }
+                int add_ret = obvectorlib::add_index(index_handler, vectors.data(), ids.data(), DIM, BATCH_SIZE);
+                if (add_ret != 0) {
+                    first_error.store(add_ret);
+                    break;
+                }
+                inserted.fetch_add(BATCH_SIZE);
+                // read after write, the nearest row of an inserted vector is the row itself
+                for (int64_t i = 0; i < BATCH_SIZE; i += 10) {
+                    obvectorlib::knn_search_into(index_handler, vectors.data() + i * DIM, DIM, 1, dist, result_id,
+                                                 result_size, EF_SEARCH, false, nullptr);
+                    if (result_size != 1 || result_id[0] != ids[i]) {
+                        invisible.fetch_add(1);
+                    }
+                }
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop.store(true);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<int64_t> all;
+    for (auto& reader_latencies : latencies) {
+        all.insert(all.end(), reader_latencies.begin(), reader_latencies.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](double p) {
+        return all.empty() ? 0 : all[std::min<size_t>(all.size() - 1, static_cast<size_t>(all.size() * p))];
+    };
+    int64_t size = 0;
+    obvectorlib::get_index_number(index_handler, size);
+    std::cout << "index_type: " << index_type << ", readers: " << reader_num << ", writers: " << writer_num
+              << ", seconds: " << seconds << std::endl;
+    std::cout << "searches: " << all.size() << ", qps: " << all.size() / std::max(seconds, 1)
+              << ", latency us p50: " << percentile(0.5) << ", p99: " << percentile(0.99)
+              << ", p999: " << percentile(0.999) << ", max: " << (all.empty() ? 0 : all.back()) << std::endl;
+    std::cout << "inserted: " << inserted.load() << ", index size: " << size
+              << ", not found after insert: " << invisible.load() << ", error: " << first_error.load() << std::endl;
+    obvectorlib::delete_index(index_handler);
+    return first_error.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,261 @@
+#include "ob_vsag_exact_search.h"
+#include "ob_vsag_thread_pool.h"
+#include "default_logger.h"
+#include "vsag/errors.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace obvectorlib {
+
+// rows of base scanned by all queries before moving on, 256 rows of 128 floats fit in L2
+static const int64_t EXACT_BLOCK_ROWS = 256;
+
+typedef float (*DotFunc)(const float* a, const float* b, int dim);
+
+static float l2_sqr_ref(const float* a, const float* b, int dim)
+{
+    float result = 0;
+    for (int i = 0; i < dim; ++i) {
+        float diff = a[i] - b[i];
+        result += diff * diff;
+    }
+    return result;
+}
+
+static float dot_ref(const float* a, const float* b, int dim)
+{
+    float result = 0;
+    for (int i = 0; i < dim; ++i) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma")))
+static inline float hsum_avx2(__m256 v)
+{
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma")))
+static float l2_sqr_avx2(const float* a, const float* b, int dim)
+{
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= dim; i += 16) {
+        __m256 diff0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 diff1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        sum0 = _mm256_fmadd_ps(diff0, diff0, sum0);
+        sum1 = _mm256_fmadd_ps(diff1, diff1, sum1);
+    }
+    for (; i + 8 <= dim; i += 8) {
+        __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        sum0 = _mm256_fmadd_ps(diff, diff, sum0);
+    }
+    float result = hsum_avx2(_mm256_add_ps(sum0, sum1));
+    return result + l2_sqr_ref(a + i, b + i, dim - i);
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_avx2(const float* a, const float* b, int dim)
+{
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= dim; i += 16) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+    }
+    for (; i + 8 <= dim; i += 8) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+    }
+    float result = hsum_avx2(_mm256_add_ps(sum0, sum1));
+    return result + dot_ref(a + i, b + i, dim - i);
+}
+#endif
+
+static bool has_avx2()
+{
+#if defined(__x86_64__)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+static const bool USE_AVX2 = has_avx2();
+
+static float l2_sqr(const float* a, const float* b, int dim)
+{
+#if defined(__x86_64__)
+    if (USE_AVX2) {
+        return l2_sqr_avx2(a, b, dim);
+    }
+#endif
+    return l2_sqr_ref(a, b, dim);
+}
+
+static float dot(const float* a, const float* b, int dim)
+{
+#if defined(__x86_64__)
+    if (USE_AVX2) {
+        return dot_avx2(a, b, dim);
+    }
+#endif
+    return dot_ref(a, b, dim);
+}
+
+ObDistanceType get_distance_type(const char* metric)
+{
+    if (metric == nullptr) {
+        return INVALID_DISTANCE;
+    } else if (strcmp(metric, "l2") == 0) {
+        return L2_DISTANCE;
+    } else if (strcmp(metric, "ip") == 0) {
+        return IP_DISTANCE;
+    } else if (strcmp(metric, "cosine") == 0) {
+        return COSINE_DISTANCE;
+    }
+    return INVALID_DISTANCE;
+}
+
+// base_norms holds the l2 norms of the rows for COSINE_DISTANCE
+static void block_distances(ObDistanceType type, const float* query, float query_norm,
+                            const float* base, const float* base_norms, int64_t count, int dim, float* dists)
+{
+    for (int64_t i = 0; i < count; ++i) {
+        const float* row = base + i * dim;
+        if (L2_DISTANCE == type) {
+            dists[i] = l2_sqr(query, row, dim);
+        } else if (IP_DISTANCE == type) {
+            dists[i] = 1 - dot(query, row, dim);
+        } else {
+            float norm = query_norm * base_norms[i];
+            dists[i] = norm > 0 ? 1 - dot(query, row, dim) / norm : 1;
+        }
+    }
+}
+
+static void row_norms(const float* base, int64_t count, int dim, float* norms)
+{
+    for (int64_t i = 0; i < count; ++i) {
+        norms[i] = std::sqrt(dot(base + i * dim, base + i * dim, dim));
+    }
+}
+
+void compute_distances(ObDistanceType type, const float* query, const float* base,
+                       int64_t count, int dim, float* dists)
+{
+    std::vector<float> norms;
+    float query_norm = 0;
+    if (COSINE_DISTANCE == type) {
+        norms.resize(count);
+        row_norms(base, count, dim, norms.data());
+        query_norm = std::sqrt(dot(query, query, dim));
+    }
+    block_distances(type, query, query_norm, base, norms.data(), count, dim, dists);
+}
+
+void ObTopkHeap::push(float dist, int64_t id)
+{
+    if (static_cast<int64_t>(items_.size()) < topk_) {
+        items_.emplace_back(dist, id);
+        std::push_heap(items_.begin(), items_.end());
+    } else if (topk_ > 0 && dist < items_.front().first) {
+        std::pop_heap(items_.begin(), items_.end());
+        items_.back() = std::make_pair(dist, id);
+        std::push_heap(items_.begin(), items_.end());
+    }
+}
+
+void ObTopkHeap::merge(const ObTopkHeap& other)
+{
+    for (const auto& item : other.items_) {
+        push(item.first, item.second);
+    }
+}
+
+int64_t ObTopkHeap::pop_sorted(float* dists, int64_t* ids)
+{
+    std::sort_heap(items_.begin(), items_.end());
+    int64_t count = static_cast<int64_t>(items_.size());
+    for (int64_t i = 0; i < count; ++i) {
+        dists[i] = items_[i].first;
+        ids[i] = items_[i].second;
+    }
+    items_.clear();
+    return count;
+}
+
+int exact_knn(ObDistanceType type, const float* base, const int64_t* base_ids, int64_t base_count, int dim,
+              const float* query_vectors, int64_t query_count, int64_t topk,
+              FilterInterface* filter, bool reverse_filter, int64_t tenant_id, int thread_num,
+              float* dists, int64_t* ids, int64_t* result_sizes)
+{
+    if (INVALID_DISTANCE == type || dim <= 0 || topk < 0 || (base == nullptr && base_count > 0)) {
+        vsag::logger::error("   invalid exact search argument, type:{}, dim:{}, topk:{}",
+                            static_cast<int>(type), dim, topk);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    }
+    if (topk == 0) {
+        std::fill(result_sizes, result_sizes + query_count, 0);
+        return 0;
+    }
+    const int64_t block_count = (base_count + EXACT_BLOCK_ROWS - 1) / EXACT_BLOCK_ROWS;
+    // a stripe is a range of blocks scanned by one thread into its own heaps
+    const int64_t stripe_count = std::max<int64_t>(1, std::min<int64_t>(std::max(thread_num, 1), block_count));
+    std::vector<std::vector<ObTopkHeap>> heaps(stripe_count, std::vector<ObTopkHeap>(query_count, ObTopkHeap(topk)));
+    std::vector<float> query_norms(query_count, 0);
+    if (COSINE_DISTANCE == type) {
+        row_norms(query_vectors, query_count, dim, query_norms.data());
+    }
+    ObTaskScheduler::instance().parallel_for(tenant_id, stripe_count, thread_num, [&](int64_t stripe) {
+        float block_dists[EXACT_BLOCK_ROWS];
+        float block_norms[EXACT_BLOCK_ROWS];
+        int64_t block_ids[EXACT_BLOCK_ROWS];
+        uint8_t filtered[EXACT_BLOCK_ROWS];
+        std::vector<ObTopkHeap>& stripe_heaps = heaps[stripe];
+        for (int64_t block = block_count * stripe / stripe_count; block < block_count * (stripe + 1) / stripe_count; ++block) {
+            const int64_t begin = block * EXACT_BLOCK_ROWS;
+            const int64_t count = std::min(EXACT_BLOCK_ROWS, base_count - begin);
+            const float* rows = base + begin * dim;
+            for (int64_t i = 0; i < count; ++i) {
+                block_ids[i] = base_ids == nullptr ? begin + i : base_ids[begin + i];
+            }
+            if (filter != nullptr) {
+                filter->test_batch(block_ids, static_cast<int>(count), filtered);
+            }
+            if (COSINE_DISTANCE == type) {
+                row_norms(rows, count, dim, block_norms);
+            }
+            for (int64_t q = 0; q < query_count; ++q) {
+                block_distances(type, query_vectors + q * dim, query_norms[q], rows, block_norms, count, dim, block_dists);
+                ObTopkHeap& heap = stripe_heaps[q];
+                for (int64_t i = 0; i < count; ++i) {
+                    if ((filter == nullptr || static_cast<bool>(filtered[i]) == reverse_filter) && heap.accept(block_dists[i])) {
+                        heap.push(block_dists[i], block_ids[i]);
+                    }
+                }
+            }
+        }
+    });
+    for (int64_t q = 0; q < query_count; ++q) {
+        for (int64_t stripe = 1; stripe < stripe_count; ++stripe) {
+            heaps[0][q].merge(heaps[stripe][q]);
+        }
+        result_sizes[q] = heaps[0][q].pop_sorted(dists + q * topk, ids + q * topk);
+    }
+    return 0;
+}
+
+} // namespace obvectorlib
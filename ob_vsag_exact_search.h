@@ -0,0 +1,54 @@
+#ifndef OB_VSAG_EXACT_SEARCH_H
+#define OB_VSAG_EXACT_SEARCH_H
+#include "ob_vsag_lib.h"
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace obvectorlib {
+
+// distances follow vsag: squared l2, 1 - inner product and 1 - cosine similarity
+enum ObDistanceType {
+  INVALID_DISTANCE = -1,
+  L2_DISTANCE = 0,
+  IP_DISTANCE = 1,
+  COSINE_DISTANCE = 2
+};
+
+ObDistanceType get_distance_type(const char* metric);
+
+// dists[i] = distance of query to row i of base (count rows of dim floats), with avx2 when the cpu has it
+void compute_distances(ObDistanceType type, const float* query, const float* base,
+                       int64_t count, int dim, float* dists);
+
+// the topk smallest (distance, id) pairs pushed into it
+class ObTopkHeap
+{
+public:
+  explicit ObTopkHeap(int64_t topk = 0) : topk_(topk) {}
+  void reset(int64_t topk) { topk_ = topk; items_.clear(); }
+  inline bool accept(float dist) const {
+    return static_cast<int64_t>(items_.size()) < topk_ || (topk_ > 0 && dist < items_.front().first);
+  }
+  void push(float dist, int64_t id);
+  void merge(const ObTopkHeap& other);
+  // write the pairs by ascending distance and return their count, the heap is left empty
+  int64_t pop_sorted(float* dists, int64_t* ids);
+private:
+  int64_t topk_;
+  std::vector<std::pair<float, int64_t>> items_;
+};
+
+/*
+ * Exact topk of query_count queries over base_count rows of base, results of query i are
+ * written at offset i * topk of dists/ids by ascending distance. base_ids holds the id of
+ * each row, NULL means row numbers. Rows are kept when filter->test(id) == reverse_filter.
+ * Rows are scanned in blocks shared by all queries, on at most thread_num threads.
+ */
+int exact_knn(ObDistanceType type, const float* base, const int64_t* base_ids, int64_t base_count, int dim,
+              const float* query_vectors, int64_t query_count, int64_t topk,
+              FilterInterface* filter, bool reverse_filter, int64_t tenant_id, int thread_num,
+              float* dists, int64_t* ids, int64_t* result_sizes);
+
+} // namespace obvectorlib
+#endif // OB_VSAG_EXACT_SEARCH_H
@@ -0,0 +1,459 @@
+#include "ob_vsag_index_file.h"
+#include "ob_vsag_thread_pool.h"
+#include "default_logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace obvectorlib {
+
+const char ObIndexFile::MAGIC[8] = {'O', 'B', 'V', 'S', 'A', 'G', 'I', 'X'};
+const uint64_t ObIndexFile::READ_CHUNK_SIZE;
+
+static const uint32_t CRC32C_POLY = 0x82F63B78;
+static const size_t WRITE_BUFFER_SIZE = 1 << 20;
+// offset, length, crc32c and key length of a table entry, followed by the key
+static const uint64_t TABLE_ENTRY_SIZE = sizeof(uint64_t) * 2 + sizeof(uint32_t) * 2;
+
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t* data, size_t size)
+{
+    static const std::vector<uint32_t> table = []() {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : (c >> 1);
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t* data, size_t size)
+{
+    uint64_t crc64 = ~crc & 0xffffffffULL;
+    while (size >= sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += sizeof(word);
+        size -= sizeof(word);
+    }
+    uint32_t crc32 = static_cast<uint32_t>(crc64);
+    while (size-- > 0) {
+        crc32 = _mm_crc32_u8(crc32, *data++);
+    }
+    return ~crc32;
+}
+#endif
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t size)
+{
+#if defined(__x86_64__)
+    static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+    if (has_sse42) {
+        return crc32c_hw(crc, static_cast<const uint8_t*>(data), size);
+    }
+#endif
+    return crc32c_sw(crc, static_cast<const uint8_t*>(data), size);
+}
+
+// integers of the file are little endian whatever the byte order of the host
+static void put_le(std::string& buf, uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        buf.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+static uint64_t get_le(const char* buf, size_t size)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(buf[i])) << (8 * i);
+    }
+    return value;
+}
+
+static void put_u32(std::string& buf, uint32_t value)
+{
+    put_le(buf, value, sizeof(value));
+}
+
+static void put_u64(std::string& buf, uint64_t value)
+{
+    put_le(buf, value, sizeof(value));
+}
+
+static uint32_t get_u32(const char* buf)
+{
+    return static_cast<uint32_t>(get_le(buf, sizeof(uint32_t)));
+}
+
+static uint64_t get_u64(const char* buf)
+{
+    return get_le(buf, sizeof(uint64_t));
+}
+
+static uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static int write_fully(int fd, const char* data, size_t size)
+{
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return static_cast<int>(vsag::ErrorType::INTERNAL_ERROR);
+        }
+        data += written;
+        size -= written;
+    }
+    return 0;
+}
+
+static int pread_fully(int fd, char* data, size_t size, uint64_t offset)
+{
+    while (size > 0) {
+        ssize_t read_size = ::pread(fd, data, size, offset);
+        if (read_size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return static_cast<int>(vsag::ErrorType::READ_ERROR);
+        } else if (read_size == 0) {
+            return static_cast<int>(vsag::ErrorType::READ_ERROR);
+        }
+        data += read_size;
+        size -= read_size;
+        offset += read_size;
+    }
+    return 0;
+}
+
+// sequential writer collecting small writes in one buffer, large sections go to the file directly
+class BufferedFileWriter
+{
+public:
+    explicit BufferedFileWriter(int fd) : fd_(fd), offset_(0) { buffer_.reserve(WRITE_BUFFER_SIZE); }
+
+    int append(const char* data, size_t size) {
+        int ret = 0;
+        if (buffer_.size() + size > WRITE_BUFFER_SIZE && (ret = flush()) != 0) {
+            return ret;
+        }
+        if (size >= WRITE_BUFFER_SIZE) {
+            ret = write_fully(fd_, data, size);
+        } else {
+            buffer_.append(data, size);
+        }
+        offset_ += size;
+        return ret;
+    }
+
+    int pad_to(uint64_t offset) {
+        const std::string zeros(offset - offset_, '\0');
+        return append(zeros.data(), zeros.size());
+    }
+
+    int flush() {
+        int ret = write_fully(fd_, buffer_.data(), buffer_.size());
+        buffer_.clear();
+        return ret;
+    }
+
+private:
+    int fd_;
+    uint64_t offset_;
+    std::string buffer_;
+};
+
+static int sync_parent_dir(const std::string& path)
+{
+    size_t pos = path.find_last_of('/');
+    std::string dir = pos == std::string::npos ? "." : path.substr(0, pos + 1);
+    int fd = ::open(dir.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return static_cast<int>(vsag::ErrorType::INTERNAL_ERROR);
+    }
+    ::fsync(fd);
+    ::close(fd);
+    return 0;
+}
+
+int ObIndexFile::write(const std::string& path, const vsag::BinarySet& binary_set)
+{
+    int ret = 0;
+    std::vector<std::string> keys = binary_set.GetKeys();
+    std::vector<vsag::Binary> binaries;
+    uint64_t table_size = 0;
+    for (const auto& key : keys) {
+        binaries.push_back(binary_set.Get(key));
+        table_size += TABLE_ENTRY_SIZE + key.size();
+    }
+    std::string table;
+    uint64_t offset = align_up(HEADER_SIZE + table_size, SECTION_ALIGNMENT);
+    std::vector<uint64_t> offsets;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const vsag::Binary& binary = binaries[i];
+        offsets.push_back(offset);
+        put_u64(table, offset);
+        put_u64(table, binary.size);
+        put_u32(table, crc32c(0, binary.data.get(), binary.size));
+        put_u32(table, static_cast<uint32_t>(keys[i].size()));
+        table.append(keys[i]);
+        offset = align_up(offset + binary.size, SECTION_ALIGNMENT);
+    }
+    std::string header(MAGIC, sizeof(MAGIC));
+    put_u32(header, VERSION);
+    put_u32(header, static_cast<uint32_t>(keys.size()));
+    put_u64(header, table.size());
+    put_u32(header, crc32c(0, table.data(), table.size()));
+    put_u32(header, 0);
+
+    const std::string tmp_path = path + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        vsag::logger::error("   fail to create index file:{}, errno:{}", tmp_path, errno);
+        return static_cast<int>(vsag::ErrorType::INTERNAL_ERROR);
+    }
+    BufferedFileWriter writer(fd);
+    if ((ret = writer.append(header.data(), header.size())) == 0) {
+        ret = writer.append(table.data(), table.size());
+    }
+    for (size_t i = 0; ret == 0 && i < keys.size(); ++i) {
+        if ((ret = writer.pad_to(offsets[i])) == 0) {
+            ret = writer.append(reinterpret_cast<const char*>(binaries[i].data.get()), binaries[i].size);
+        }
+    }
+    if (ret == 0 && (ret = writer.flush()) == 0 && ::fsync(fd) != 0) {
+        ret = static_cast<int>(vsag::ErrorType::INTERNAL_ERROR);
+    }
+    ::close(fd);
+    if (ret == 0 && ::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        ret = static_cast<int>(vsag::ErrorType::INTERNAL_ERROR);
+    }
+    if (ret != 0) {
+        vsag::logger::error("   fail to write index file:{}, ret={}, errno:{}", path, ret, errno);
+        ::unlink(tmp_path.c_str());
+        return ret;
+    }
+    return sync_parent_dir(path);
+}
+
+bool ObIndexFile::exists(const std::string& path)
+{
+    struct stat file_stat;
+    return ::stat(path.c_str(), &file_stat) == 0;
+}
+
+int ObIndexFile::open(const std::string& path)
+{
+    close();
+    path_ = path;
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        OB_VSAG_LOG_DEBUG("   fail to open index file:{}, errno:{}", path, errno);
+        return static_cast<int>(vsag::ErrorType::MISSING_FILE);
+    }
+    struct stat file_stat;
+    if (::fstat(fd_, &file_stat) != 0) {
+        return static_cast<int>(vsag::ErrorType::READ_ERROR);
+    }
+    file_size_ = file_stat.st_size;
+    char header[HEADER_SIZE];
+    int ret = 0;
+    if (file_size_ < HEADER_SIZE || (ret = pread_fully(fd_, header, HEADER_SIZE, 0)) != 0
+        || memcmp(header, MAGIC, sizeof(MAGIC)) != 0 || get_u32(header + 8) != VERSION) {
+        vsag::logger::error("   invalid index file header:{}, size:{}", path, file_size_);
+        return static_cast<int>(vsag::ErrorType::INVALID_BINARY);
+    }
+    const uint32_t section_count = get_u32(header + 12);
+    const uint64_t table_size = get_u64(header + 16);
+    const uint32_t table_crc = get_u32(header + 24);
+    if (HEADER_SIZE + table_size > file_size_) {
+        return static_cast<int>(vsag::ErrorType::INVALID_BINARY);
+    }
+    std::string table(table_size, '\0');
+    if ((ret = pread_fully(fd_, &table[0], table_size, HEADER_SIZE)) != 0) {
+        return ret;
+    } else if (crc32c(0, table.data(), table.size()) != table_crc) {
+        vsag::logger::error("   index file table checksum mismatch:{}", path);
+        return static_cast<int>(vsag::ErrorType::INVALID_BINARY);
+    }
+    uint64_t pos = 0;
+    for (uint32_t i = 0; i < section_count; ++i) {
+        if (pos + TABLE_ENTRY_SIZE > table_size) {
+            return static_cast<int>(vsag::ErrorType::INVALID_BINARY);
+        }
+        ObIndexFileSection section;
+        section.offset_ = get_u64(table.data() + pos);
+        section.length_ = get_u64(table.data() + pos + 8);
+        section.crc_ = get_u32(table.data() + pos + 16);
+        const uint32_t key_length = get_u32(table.data() + pos + 20);
+        pos += TABLE_ENTRY_SIZE;
+        if (pos + key_length > table_size || section.offset_ + section.length_ > file_size_) {
+            return static_cast<int>(vsag::ErrorType::INVALID_BINARY);
+        }
+        section.key_.assign(table.data() + pos, key_length);
+        pos += key_length;
+        sections_.push_back(section);
+    }
+    return 0;
+}
+
+void ObIndexFile::close()
+{
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    sections_.clear();
+    mapping_.reset();
+}
+
+int ObIndexFile::map_file()
+{
+    if (mapping_ != nullptr) {
+        return 0;
+    }
+    void* addr = ::mmap(nullptr, file_size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (addr == MAP_FAILED) {
+        OB_VSAG_LOG_DEBUG("   fail to mmap index file:{}, size:{}, errno:{}", path_, file_size_, errno);
+        return static_cast<int>(vsag::ErrorType::READ_ERROR);
+    }
+    const uint64_t size = file_size_;
+    mapping_ = std::shared_ptr<int8_t[]>(static_cast<int8_t*>(addr),
+                                          [size](int8_t* data) { ::munmap(data, size); });
+    return 0;
+}
+
+int ObIndexFile::verify_section(const ObIndexFileSection& section, const vsag::Binary& binary)
+{
+    if (crc32c(0, binary.data.get(), binary.size) != section.crc_) {
+        vsag::logger::error("   index file section checksum mismatch:{}, key:{}", path_, section.key_);
+        return static_cast<int>(vsag::ErrorType::INVALID_BINARY);
+    }
+    return 0;
+}
+
+int ObIndexFile::read_sections(bool use_mmap, int64_t tenant_id, std::vector<vsag::Binary>& binaries)
+{
+    int ret = 0;
+    binaries.assign(sections_.size(), vsag::Binary());
+    struct Chunk {
+        size_t section_idx_;
+        uint64_t offset_;
+        uint64_t length_;
+    };
+    std::vector<Chunk> chunks;
+    for (size_t i = 0; i < sections_.size(); ++i) {
+        const ObIndexFileSection& section = sections_[i];
+        binaries[i].size = section.length_;
+        if (section.length_ == 0) {
+            continue;
+        } else if (use_mmap) {
+            if (ret == 0 && (ret = map_file()) != 0) {
+                return ret;
+            }
+            binaries[i].data = std::shared_ptr<int8_t[]>(mapping_, mapping_.get() + section.offset_);
+        } else {
+            binaries[i].data.reset(new int8_t[section.length_]);
+            for (uint64_t offset = 0; offset < section.length_; offset += READ_CHUNK_SIZE) {
+                chunks.push_back(Chunk{i, offset, std::min(READ_CHUNK_SIZE, section.length_ - offset)});
+            }
+        }
+    }
+    ObTaskScheduler& scheduler = ObTaskScheduler::instance();
+    std::atomic<int> first_error(0);
+    auto set_error = [&first_error](int error) {
+        int expected = 0;
+        first_error.compare_exchange_strong(expected, error);
+    };
+    scheduler.parallel_for(tenant_id, chunks.size(), scheduler.get_max_threads(), [&](int64_t i) {
+        const Chunk& chunk = chunks[i];
+        char* dest = reinterpret_cast<char*>(binaries[chunk.section_idx_].data.get()) + chunk.offset_;
+        int chunk_ret = pread_fully(fd_, dest, chunk.length_, sections_[chunk.section_idx_].offset_ + chunk.offset_);
+        if (chunk_ret != 0) {
+            set_error(chunk_ret);
+        }
+    });
+    if ((ret = first_error.load()) != 0) {
+        vsag::logger::error("   fail to read index file:{}, ret={}", path_, ret);
+        return ret;
+    }
+    // with mmap this also pages the sections in, one thread per section
+    scheduler.parallel_for(tenant_id, sections_.size(), scheduler.get_max_threads(), [&](int64_t i) {
+        int section_ret = verify_section(sections_[i], binaries[i]);
+        if (section_ret != 0) {
+            set_error(section_ret);
+        }
+    });
+    return first_error.load();
+}
+
+void ObBinaryReader::Read(uint64_t offset, uint64_t len, void* dest)
+{
+    memcpy(dest, binary_.data.get() + offset, len);
+}
+
+void ObBinaryReader::AsyncRead(uint64_t offset, uint64_t len, void* dest, vsag::CallBack callback)
+{
+    Read(offset, len, dest);
+    callback(vsag::IOErrorCode::IO_SUCCESS, "success");
+}
+
+int map_binary(const std::string& path, vsag::Binary& binary)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        OB_VSAG_LOG_DEBUG("   fail to open index file:{}, errno:{}", path, errno);
+        return static_cast<int>(vsag::ErrorType::MISSING_FILE);
+    }
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) != 0) {
+        ::close(fd);
+        return static_cast<int>(vsag::ErrorType::READ_ERROR);
+    }
+    const size_t size = static_cast<size_t>(file_stat.st_size);
+    binary.size = size;
+    if (size == 0) {
+        ::close(fd);
+        binary.data.reset();
+        return 0;
+    }
+    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        OB_VSAG_LOG_DEBUG("   fail to mmap index file:{}, size:{}, errno:{}", path, size, errno);
+        return static_cast<int>(vsag::ErrorType::READ_ERROR);
+    }
+    // vsag reads every section once from start to end while deserializing
+    ::madvise(addr, size, MADV_SEQUENTIAL);
+    binary.data = std::shared_ptr<int8_t[]>(static_cast<int8_t*>(addr),
+                                             [size](int8_t* data) { ::munmap(data, size); });
+    return 0;
+}
+
+} // namespace obvectorlib
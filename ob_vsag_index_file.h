@@ -0,0 +1,80 @@
+#ifndef OB_VSAG_INDEX_FILE_H
+#define OB_VSAG_INDEX_FILE_H
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <vsag/vsag.h>
+
+namespace obvectorlib {
+
+/*
+ * Single file layout written by serialize:
+ *
+ *   header  | magic "OBVSAGIX", version, section count, table size, table crc32c
+ *   table   | per section: offset, length, crc32c, key length, key
+ *   data    | sections, each starting at a ObIndexFile::SECTION_ALIGNMENT boundary
+ *
+ * All integers are little endian. The file is written to <path>.tmp, synced and
+ * renamed to <path>, so a reader never sees a partially written file, and every
+ * section can be read and verified on its own with positioned reads.
+ */
+struct ObIndexFileSection {
+  std::string key_;
+  uint64_t offset_;
+  uint64_t length_;
+  uint32_t crc_;
+};
+
+class ObIndexFile
+{
+public:
+  static const char MAGIC[8];
+  static const uint32_t VERSION = 1;
+  static const uint64_t HEADER_SIZE = 32;
+  static const uint64_t SECTION_ALIGNMENT = 4096;
+  static const uint64_t READ_CHUNK_SIZE = 8 << 20;
+
+  ObIndexFile() : fd_(-1), file_size_(0) {}
+  ~ObIndexFile() { close(); }
+
+  // write all sections of binary_set to path
+  static int write(const std::string& path, const vsag::BinarySet& binary_set);
+  static bool exists(const std::string& path);
+
+  int open(const std::string& path);
+  void close();
+  const std::vector<ObIndexFileSection>& get_sections() const { return sections_; }
+  // read all sections, large sections in READ_CHUNK_SIZE chunks, and check their CRCs in parallel
+  // on the task scheduler, the sections are only read and verified here, not decoded
+  int read_sections(bool use_mmap, int64_t tenant_id, std::vector<vsag::Binary>& binaries);
+
+private:
+  int map_file();
+  int verify_section(const ObIndexFileSection& section, const vsag::Binary& binary);
+
+  std::string path_;
+  int fd_;
+  uint64_t file_size_;
+  std::vector<ObIndexFileSection> sections_;
+  std::shared_ptr<int8_t[]> mapping_;
+};
+
+// vsag::Reader over a section read or mapped by ObIndexFile, it shares the buffer or mapping
+class ObBinaryReader : public vsag::Reader
+{
+public:
+  explicit ObBinaryReader(const vsag::Binary& binary) : binary_(binary) {}
+  void Read(uint64_t offset, uint64_t len, void* dest) override;
+  void AsyncRead(uint64_t offset, uint64_t len, void* dest, vsag::CallBack callback) override;
+  uint64_t Size() const override { return binary_.size; }
+
+private:
+  vsag::Binary binary_;
+};
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t size);
+// map a whole file read-only, the mapping is released with the last reference to binary.data
+int map_binary(const std::string& path, vsag::Binary& binary);
+
+} // namespace obvectorlib
+#endif // OB_VSAG_INDEX_FILE_H
@@ -1,6 +1,10 @@
 
 #include "ob_vsag_lib.h"
 #include "ob_vsag_lib_c.h"
+#include "ob_vsag_thread_pool.h"
+#include "ob_vsag_index_file.h"
+#include "ob_vsag_exact_search.h"
+#include "ob_vsag_vector_convert.h"
 #include "nlohmann/json.hpp"
 #include "roaring/roaring64.h"
 #include <vsag/vsag.h>
@@ -18,52 +22,251 @@
 
 #include <fstream>
 #include <chrono>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <mutex>
+#include <condition_variable>
+#include <shared_mutex>
+#include <tuple>
+#include <unordered_set>
+#include <set>
+#include <random>
+#include <cmath>
+#include <cstdlib>
 
 namespace obvectorlib {
 
+class HnswIndexHandler;
+
+// slow log settings of one operation, see set_slow_log
+struct SlowLogConfig {
+    std::atomic<int64_t> threshold_us_{-1};
+    std::atomic<int64_t> sample_interval_{1};
+    std::atomic<int64_t> slow_count_{0};
+};
+
+static SlowLogConfig slow_log_configs[MAX_OP];
+static const char* const OP_NAMES[MAX_OP] = {
+    "knn_search", "knn_search_batch", "build_index", "add_index",
+    "update_index", "remove_index", "serialize", "deserialize"
+};
+
+// logs a call of op slower than its threshold when it goes out of scope, ret and the
+// context fields set by the caller are read at that time
 struct SlowTaskTimer {
-    SlowTaskTimer(const std::string& name, int64_t log_threshold_ms = 0);
+    SlowTaskTimer(IndexOpType op, HnswIndexHandler* hnsw, const int& ret);
     ~SlowTaskTimer();
 
-    std::string name;
+    IndexOpType op;
+    HnswIndexHandler* hnsw;
+    const int& ret;
     int64_t threshold;
     std::chrono::steady_clock::time_point start;
+    int64_t topk = 0;
+    int ef_search = 0;
+    bool filtered = false;
+    float valid_ratio = 1.0;
+    int64_t rows = 0;
 };
 
-SlowTaskTimer::SlowTaskTimer(const std::string& n, int64_t log_threshold_ms)
-    : name(n), threshold(log_threshold_ms) {
-    start = std::chrono::steady_clock::now();
-}
-
-SlowTaskTimer::~SlowTaskTimer() {
-    auto finish = std::chrono::steady_clock::now();
-    std::chrono::duration<double, std::milli> duration = finish - start;
-    if (duration.count() > threshold) {
-        if (duration.count() >= 1000) {
-            vsag::logger::debug("  {0} cost {1:.3f}s", name, duration.count() / 1000);
-        } else {
-            vsag::logger::debug("  {0} cost {1:.3f}ms", name, duration.count());
-        }
-    }
-}
+static const int MAX_FILTER_BATCH_SIZE = 64;
+static const int64_t FILTER_BLOCK_CACHE_SLOTS = 1024;
 
 class ObVasgFilter : public vsag::Filter
 {
 public:
-    ObVasgFilter(float valid_ratio,
-                 const std::function<bool(int64_t)>& vid_fallback_func,
-                 const std::function<bool(const char*)>& exinfo_fallback_func) 
-        : valid_ratio_(valid_ratio), vid_fallback_func_(vid_fallback_func), exinfo_fallback_func_(exinfo_fallback_func)
+    ObVasgFilter(float valid_ratio, FilterInterface* bitmap, bool reverse_filter)
+        : valid_ratio_(valid_ratio),
+          bitmap_(bitmap),
+          reverse_filter_(reverse_filter),
+          batch_size_(std::min(std::max(bitmap->batch_size(), 0), MAX_FILTER_BATCH_SIZE))
     {};
 
     ~ObVasgFilter() {}
     
     bool CheckValid(int64_t id) const override {
-        return !vid_fallback_func_(id);
+        bool filtered = batch_size_ > 1 ? test_in_block(id) : bitmap_->test(id);
+        return filtered == reverse_filter_;
+    }
+
+    bool CheckValid(const char* data) const override {
+        return bitmap_->test(data) == reverse_filter_;
+    }
+
+    float ValidRatio() const override {
+        return valid_ratio_;
+    }
+
+    // the block cache is not synchronized, a filter with batch evaluation serves one search at a time
+    bool is_shareable() const { return batch_size_ <= 1; }
+
+private:
+    bool test_in_block(int64_t id) const;
+
+    struct BlockCacheSlot {
+        int64_t block_start_;
+        uint64_t filtered_mask_;
+    };
+
+    float valid_ratio_;
+    FilterInterface* bitmap_;
+    bool reverse_filter_;
+    int batch_size_;
+    mutable std::vector<BlockCacheSlot> block_cache_;
+};
+
+// evaluate the whole aligned block of batch_size_ ids around id with one test_batch call,
+// so the caller can check visibility of neighboring rows with SIMD and prefetching
+bool ObVasgFilter::test_in_block(int64_t id) const
+{
+    const int64_t offset = ((id % batch_size_) + batch_size_) % batch_size_;
+    const int64_t block_start = id - offset;
+    if (block_cache_.empty()) {
+        block_cache_.assign(FILTER_BLOCK_CACHE_SLOTS, BlockCacheSlot{INT64_MIN, 0});
+    }
+    BlockCacheSlot& slot = block_cache_[(block_start / batch_size_) & (FILTER_BLOCK_CACHE_SLOTS - 1)];
+    if (slot.block_start_ != block_start) {
+        int64_t ids[MAX_FILTER_BATCH_SIZE];
+        uint8_t filtered[MAX_FILTER_BATCH_SIZE];
+        for (int i = 0; i < batch_size_; ++i) {
+            ids[i] = block_start + i;
+        }
+        bitmap_->test_batch(ids, batch_size_, filtered);
+        uint64_t mask = 0;
+        for (int i = 0; i < batch_size_; ++i) {
+            mask |= static_cast<uint64_t>(filtered[i] != 0) << i;
+        }
+        slot.block_start_ = block_start;
+        slot.filtered_mask_ = mask;
+    }
+    return (slot.filtered_mask_ >> offset) & 1;
+}
+
+// native filters check the bitmap inline, reverse_filter is folded in at construction
+class ObRoaringVsagFilter final : public vsag::Filter
+{
+public:
+    ObRoaringVsagFilter(float valid_ratio, const roaring::api::roaring64_bitmap_t* bitmap, bool reverse_filter)
+        : valid_ratio_(valid_ratio), bitmap_(bitmap), valid_when_contained_(reverse_filter)
+    {}
+
+    bool CheckValid(int64_t id) const override {
+        return roaring::api::roaring64_bitmap_contains(bitmap_, id) == valid_when_contained_;
+    }
+
+    // id filters do not check extra infos, same as RoaringFilter::test(const char*) returning false
+    bool CheckValid(const char* /*data*/) const override {
+        return !valid_when_contained_;
+    }
+
+    float ValidRatio() const override {
+        return valid_ratio_;
+    }
+
+private:
+    float valid_ratio_;
+    const roaring::api::roaring64_bitmap_t* bitmap_;
+    bool valid_when_contained_;
+};
+
+class ObBitsetVsagFilter final : public vsag::Filter
+{
+public:
+    ObBitsetVsagFilter(float valid_ratio, const BitsetFilter* bitset, bool reverse_filter)
+        : valid_ratio_(valid_ratio), bitset_(bitset), valid_when_contained_(reverse_filter)
+    {}
+
+    bool CheckValid(int64_t id) const override {
+        return bitset_->contains(id) == valid_when_contained_;
+    }
+
+    bool CheckValid(const char* /*data*/) const override {
+        return !valid_when_contained_;
+    }
+
+    float ValidRatio() const override {
+        return valid_ratio_;
+    }
+
+private:
+    float valid_ratio_;
+    const BitsetFilter* bitset_;
+    bool valid_when_contained_;
+};
+
+bool RoaringFilter::test(int64_t id)
+{
+    return roaring::api::roaring64_bitmap_contains(
+        static_cast<const roaring::api::roaring64_bitmap_t*>(bitmap_), id);
+}
+
+// bitmap of a RoaringFilter, NULL for other filters, including ones reporting ROARING_FILTER_TYPE
+static const roaring::api::roaring64_bitmap_t* get_roaring_bitmap(FilterInterface *bitmap)
+{
+    RoaringFilter* roaring_filter = ROARING_FILTER_TYPE == bitmap->get_filter_type()
+        ? dynamic_cast<RoaringFilter*>(bitmap) : nullptr;
+    return roaring_filter == nullptr
+        ? nullptr : static_cast<const roaring::api::roaring64_bitmap_t*>(roaring_filter->get_bitmap());
+}
+
+// BitsetFilter of a filter reporting BITSET_FILTER_TYPE, NULL for other filters
+static const BitsetFilter* get_bitset_filter(FilterInterface *bitmap)
+{
+    return BITSET_FILTER_TYPE == bitmap->get_filter_type() ? dynamic_cast<BitsetFilter*>(bitmap) : nullptr;
+}
+
+static vsag::FilterPtr make_vsag_filter(FilterInterface *bitmap, bool reverse_filter, float valid_ratio)
+{
+    if (bitmap == nullptr) {
+        return nullptr;
+    }
+    // the type is only trusted for the classes declaring it, other filters go through test
+    const roaring::api::roaring64_bitmap_t* roaring = get_roaring_bitmap(bitmap);
+    const BitsetFilter* bitset = get_bitset_filter(bitmap);
+    if (roaring != nullptr) {
+        return std::make_shared<ObRoaringVsagFilter>(valid_ratio, roaring, reverse_filter);
+    } else if (bitset != nullptr) {
+        return std::make_shared<ObBitsetVsagFilter>(valid_ratio, bitset, reverse_filter);
+    }
+    return std::make_shared<ObVasgFilter>(valid_ratio, bitmap, reverse_filter);
+}
+
+// immutable copy of the removed ids, replaced as a whole on every change
+typedef std::shared_ptr<const roaring::api::roaring64_bitmap_t> TombstoneSnapshot;
+
+static TombstoneSnapshot make_tombstone_snapshot(roaring::api::roaring64_bitmap_t* bitmap)
+{
+    return TombstoneSnapshot(bitmap, [](const roaring::api::roaring64_bitmap_t* b) {
+        roaring::api::roaring64_bitmap_free(const_cast<roaring::api::roaring64_bitmap_t*>(b));
+    });
+}
+
+// an index and the tombstones of the rows removed from it, published as a whole so that a
+// search never pairs an index with the tombstones of another one
+struct IndexSnapshot
+{
+    std::shared_ptr<vsag::Index> index_;
+    TombstoneSnapshot tombstones_;
+    uint64_t tombstone_count_;
+};
+typedef std::shared_ptr<const IndexSnapshot> IndexSnapshotPtr;
+
+// masks removed rows the index still holds, then applies the filter of the query
+class ObTombstoneVsagFilter final : public vsag::Filter
+{
+public:
+    ObTombstoneVsagFilter(float valid_ratio, const TombstoneSnapshot& tombstones, const vsag::FilterPtr& filter)
+        : valid_ratio_(valid_ratio), tombstones_(tombstones), filter_(filter)
+    {}
+
+    bool CheckValid(int64_t id) const override {
+        return !roaring::api::roaring64_bitmap_contains(tombstones_.get(), id)
+            && (filter_ == nullptr || filter_->CheckValid(id));
     }
 
     bool CheckValid(const char* data) const override {
-        return !exinfo_fallback_func_(data);
+        return filter_ == nullptr || filter_->CheckValid(data);
     }
 
     float ValidRatio() const override {
@@ -72,10 +275,483 @@ public:
 
 private:
     float valid_ratio_;
-    std::function<bool(int64_t)> vid_fallback_func_{nullptr};
-    std::function<bool(const char*)> exinfo_fallback_func_{nullptr};
+    TombstoneSnapshot tombstones_;
+    vsag::FilterPtr filter_;
+};
+
+// searches filtering on extra infos do not see ids, drop removed rows from their results in place
+static int64_t drop_tombstones(const roaring::api::roaring64_bitmap_t* tombstones, int64_t result_size,
+                               float* dist, int64_t* ids, char* extra_infos, uint64_t extra_info_size)
+{
+    int64_t kept = 0;
+    for (int64_t i = 0; i < result_size; ++i) {
+        if (roaring::api::roaring64_bitmap_contains(tombstones, ids[i])) {
+            continue;
+        }
+        if (kept != i) {
+            dist[kept] = dist[i];
+            ids[kept] = ids[i];
+            if (extra_infos != nullptr) {
+                memmove(extra_infos + kept * extra_info_size, extra_infos + i * extra_info_size, extra_info_size);
+            }
+        }
+        ++kept;
+    }
+    return kept;
+}
+
+/*
+ * search(fetch) returns at most fetch rows, of which those removed are dropped. While fewer
+ * than count rows are left and the index may hold more, the search runs again for twice as
+ * many rows, at most count plus the tombstone count, which always leaves count live rows.
+ * The result keeps at most count rows, count < 0 keeps all of them.
+ */
+template <typename SearchFn>
+static auto search_live_rows(const IndexSnapshot& snapshot, int64_t count, uint64_t extra_info_size, SearchFn search)
+{
+    int64_t fetch = count;
+    while (true) {
+        auto result = search(fetch);
+        if (!result.has_value() || snapshot.tombstones_ == nullptr) {
+            return result;
+        }
+        const vsag::DatasetPtr& dataset = result.value();
+        const int64_t raw_size = dataset->GetDim();
+        char* extra_infos = extra_info_size > 0 ? const_cast<char*>(dataset->GetExtraInfos()) : nullptr;
+        const int64_t kept = drop_tombstones(snapshot.tombstones_.get(), raw_size, const_cast<float*>(dataset->GetDistances()),
+                                             const_cast<int64_t*>(dataset->GetIds()), extra_infos, extra_info_size);
+        const int64_t max_fetch = count + static_cast<int64_t>(snapshot.tombstone_count_);
+        if (count < 0 || kept >= count || raw_size < fetch || fetch >= max_fetch) {
+            dataset->Dim(count < 0 ? kept : std::min(kept, count));
+            return result;
+        }
+        fetch = std::min(max_fetch, fetch * 2);
+    }
+}
+
+static const char* get_index_type_str(IndexType index_type)
+{
+    if (HNSW_TYPE == index_type) {
+        return "hnsw";
+    } else if (HNSW_SQ_TYPE == index_type || HNSW_BQ_TYPE == index_type || HGRAPH_TYPE == index_type) {
+        return "hgraph";
+    }
+    return "";
+}
+
+// "float16"/"bfloat16" rows are given to vsag as fp32 and stored at half precision by the
+// types keeping their vectors in a quantization of their own choice
+static const char* get_vsag_dtype(const char* dtype)
+{
+    if (0 == strcmp(dtype, "float16") || 0 == strcmp(dtype, "bfloat16")) {
+        return "float32";
+    }
+    return dtype;
+}
+
+static const char* get_float_storage_type(const char* dtype)
+{
+    if (0 == strcmp(dtype, "float16")) {
+        return "fp16";
+    } else if (0 == strcmp(dtype, "bfloat16")) {
+        return "bf16";
+    }
+    return "fp32";
+}
+
+// HNSW_TYPE and HNSW_SQ_TYPE have no half precision storage, they would keep fp32 or sq8 rows,
+// only the hnsw of vsag keeps "int8" rows as they are
+static bool is_supported_dtype(IndexType index_type, const char* dtype)
+{
+    if (0 == strcmp(dtype, "int8")) {
+        return HNSW_TYPE == index_type;
+    }
+    return 0 != strcmp(get_float_storage_type(dtype), "fp32")
+        ? HGRAPH_TYPE == index_type || HNSW_BQ_TYPE == index_type : true;
+}
+
+// max_degree is the value passed to vsag, hgraph based types use twice the max_degree of create_index
+// hgraph starts build_thread_count threads of its own, outside the task scheduler, so they
+// are kept within the threads the tenant may occupy
+static int clamp_build_thread_count(int64_t tenant_id, int build_thread_count)
+{
+    return std::min(build_thread_count, ObTaskScheduler::instance().get_thread_limit(tenant_id));
+}
+
+static nlohmann::json make_index_parameters(IndexType index_type, const char* dtype, const char* metric, int dim,
+                                            int max_degree, int ef_construction, int ef_search, bool use_static,
+                                            uint64_t extra_info_size, int build_thread_count, int64_t tenant_id,
+                                            const std::string& precise_file_path = std::string())
+{
+    nlohmann::json index_parameters;
+    build_thread_count = clamp_build_thread_count(tenant_id, build_thread_count);
+    if (HNSW_TYPE == index_type) {
+        nlohmann::json hnsw_parameters{{"max_degree", max_degree},
+                                {"ef_construction", ef_construction},
+                                {"ef_search", ef_search},
+                                {"use_static", use_static}};
+        index_parameters = {{"dtype", get_vsag_dtype(dtype)}, {"metric_type", metric}, {"dim", dim}, {"hnsw", hnsw_parameters}};
+    } else if (HNSW_SQ_TYPE == index_type || HGRAPH_TYPE == index_type) {
+        nlohmann::json hnswsq_parameters{{"base_quantization_type", HNSW_SQ_TYPE == index_type ? "sq8" : get_float_storage_type(dtype)},
+                                         {"max_degree", max_degree},
+                                         {"ef_construction", ef_construction},
+                                         {"build_thread_count", build_thread_count}};
+        index_parameters = {{"dtype", get_vsag_dtype(dtype)}, {"metric_type", metric}, {"dim", dim}, {"extra_info_size", extra_info_size}, {"index_param", hnswsq_parameters}};
+    } else if (HNSW_BQ_TYPE == index_type) {
+        nlohmann::json hnswbq_parameters{{"base_quantization_type", "rabitq"},
+                                         {"max_degree", max_degree},
+                                         {"ef_construction", ef_construction},
+                                         {"build_thread_count", build_thread_count},
+                                         {"use_reorder", true},
+                                         {"ignore_reorder", true},
+                                         {"precise_quantization_type", get_float_storage_type(dtype)},
+                                         {"precise_io_type", "block_memory_io"}};
+        if (!precise_file_path.empty()) {
+            // precise vectors are only read by reorder, deserialize copies them to this file
+            hnswbq_parameters["precise_io_type"] = "buffer_io";
+            hnswbq_parameters["precise_file_path"] = precise_file_path;
+        }
+        index_parameters = {{"dtype", get_vsag_dtype(dtype)}, {"metric_type", metric}, {"dim", dim}, {"extra_info_size", extra_info_size}, {"index_param", hnswbq_parameters}};
+    }
+    return index_parameters;
+}
+
+static const float DEFAULT_SKIP_RATIO = 0.7f;
+
+static std::string make_search_parameters(IndexType index_type, int ef_search, bool use_extra_info_filter,
+                                          float skip_ratio = DEFAULT_SKIP_RATIO)
+{
+    nlohmann::json search_parameters;
+    if (HNSW_SQ_TYPE == index_type || HNSW_BQ_TYPE == index_type || HGRAPH_TYPE == index_type) {
+        search_parameters = {{"hgraph", {{"ef_search", ef_search}, {"use_extra_info_filter", use_extra_info_filter}}},};
+    } else {
+        search_parameters = {{"hnsw", {{"ef_search", ef_search}, {"skip_ratio", skip_ratio}}},};
+    }
+    return search_parameters.dump();
+}
+
+// search parameters rendered once and reused by every query with the same settings,
+// owned by the index handler and valid until the handler is deleted
+struct SearchPlan {
+    SearchPlan(IndexType index_type, int ef_search, bool use_extra_info_filter, float skip_ratio)
+        : ef_search_(ef_search),
+          use_extra_info_filter_(use_extra_info_filter),
+          skip_ratio_(skip_ratio),
+          parameters_(make_search_parameters(index_type, ef_search, use_extra_info_filter, skip_ratio))
+    {}
+
+    int ef_search_;
+    bool use_extra_info_filter_;
+    float skip_ratio_;
+    std::string parameters_;
+};
+
+// how one filtered query runs, see HnswIndexHandler::plan_filter
+struct FilterPlan {
+    bool exact_scan_;    // score the rows kept by the filter instead of walking the graph
+    float valid_ratio_;  // estimated fraction of the rows kept by the filter
+    float skip_ratio_;
+};
+
+static const int64_t DEFAULT_EXACT_SCAN_MAX_ROWS = 2048;
+static const float DEFAULT_EXACT_SCAN_RATIO = 0.001f;
+
+// order the rows of a search result by ascending distance, range search results come unordered
+static void sort_search_result(const vsag::DatasetPtr& result, uint64_t extra_info_size)
+{
+    const int64_t count = result->GetDim();
+    float* dists = const_cast<float*>(result->GetDistances());
+    int64_t* ids = const_cast<int64_t*>(result->GetIds());
+    if (count <= 1 || std::is_sorted(dists, dists + count)) {
+        return;
+    }
+    std::vector<int64_t> order(count);
+    for (int64_t i = 0; i < count; ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [dists](int64_t a, int64_t b) { return dists[a] < dists[b]; });
+    std::vector<float> sorted_dists(count);
+    std::vector<int64_t> sorted_ids(count);
+    for (int64_t i = 0; i < count; ++i) {
+        sorted_dists[i] = dists[order[i]];
+        sorted_ids[i] = ids[order[i]];
+    }
+    memcpy(dists, sorted_dists.data(), count * sizeof(float));
+    memcpy(ids, sorted_ids.data(), count * sizeof(int64_t));
+    char* extra_infos = const_cast<char*>(result->GetExtraInfos());
+    if (extra_infos != nullptr && extra_info_size > 0) {
+        std::vector<char> sorted_extra_infos(count * extra_info_size);
+        for (int64_t i = 0; i < count; ++i) {
+            memcpy(sorted_extra_infos.data() + i * extra_info_size, extra_infos + order[i] * extra_info_size, extra_info_size);
+        }
+        memcpy(extra_infos, sorted_extra_infos.data(), count * extra_info_size);
+    }
+}
+
+// copy at most capacity rows of a search result into caller buffers, the result keeps its ownership
+static int64_t copy_search_result(const vsag::DatasetPtr& result, int64_t capacity,
+                                  float* dist, int64_t* ids,
+                                  char* extra_infos, uint64_t extra_info_size)
+{
+    int64_t count = std::min(result->GetDim(), capacity);
+    if (count > 0) {
+        memcpy(ids, result->GetIds(), count * sizeof(int64_t));
+        memcpy(dist, result->GetDistances(), count * sizeof(float));
+        if (extra_infos != nullptr && extra_info_size > 0) {
+            memcpy(extra_infos, result->GetExtraInfos(), count * extra_info_size);
+        }
+    }
+    return count;
+}
+
+/*
+ * Locks of one index handler, see the consistency model in ob_vsag_lib.h. Searches
+ * share search_mutex_. hnswlib synchronizes inserts with searches per node, so writers
+ * of HNSW_TYPE share it too, writers of other types own it for one chunk of rows at a
+ * time. Writers share write_mutex_ and serialization owns it, so a serialized index has
+ * no half applied write. Publishing another index owns write_mutex_ and takes
+ * search_mutex_ like a writer, so no write or search of the handler is still running on the
+ * index it hands over. Writers, serialization and publishing take write_mutex_ first. A
+ * writer waiting for search_mutex_ holds gate_, so a steady stream of searches cannot starve it.
+ */
+class ObIndexLock
+{
+public:
+    explicit ObIndexLock(bool concurrent_write) : concurrent_write_(concurrent_write) {}
+
+    // searches
+    void lock_shared() {
+        std::lock_guard<std::mutex> gate(gate_);
+        search_mutex_.lock_shared();
+    }
+    void unlock_shared() { search_mutex_.unlock_shared(); }
+
+    // writes
+    void lock() {
+        write_mutex_.lock_shared();
+        if (concurrent_write_) {
+            search_mutex_.lock_shared();
+        } else {
+            std::lock_guard<std::mutex> gate(gate_);
+            search_mutex_.lock();
+        }
+    }
+    void unlock() {
+        if (concurrent_write_) {
+            search_mutex_.unlock_shared();
+        } else {
+            search_mutex_.unlock();
+        }
+        write_mutex_.unlock_shared();
+    }
+
+    // serialization, searches keep running
+    void lock_serialize() {
+        write_mutex_.lock();
+        lock_shared();
+    }
+    void unlock_serialize() {
+        unlock_shared();
+        write_mutex_.unlock();
+    }
+
+    // replacing the index, see swap_index
+    void lock_publish() {
+        write_mutex_.lock();
+        if (concurrent_write_) {
+            search_mutex_.lock_shared();
+        } else {
+            std::lock_guard<std::mutex> gate(gate_);
+            search_mutex_.lock();
+        }
+    }
+    void unlock_publish() {
+        if (concurrent_write_) {
+            search_mutex_.unlock_shared();
+        } else {
+            search_mutex_.unlock();
+        }
+        write_mutex_.unlock();
+    }
+
+private:
+    bool concurrent_write_;
+    std::mutex gate_;
+    std::shared_mutex search_mutex_;
+    std::shared_mutex write_mutex_;
+};
+
+class ObSerializeGuard
+{
+public:
+    explicit ObSerializeGuard(ObIndexLock& lock) : lock_(lock) { lock_.lock_serialize(); }
+    ~ObSerializeGuard() { lock_.unlock_serialize(); }
+private:
+    ObIndexLock& lock_;
+};
+
+class ObPublishGuard
+{
+public:
+    explicit ObPublishGuard(ObIndexLock& lock) : lock_(lock) { lock_.lock_publish(); }
+    ~ObPublishGuard() { lock_.unlock_publish(); }
+private:
+    ObIndexLock& lock_;
+};
+
+// lock free counters of one index handler, relaxed ordering is enough for statistics
+class ObIndexStats
+{
+public:
+    ObIndexStats() { reset(); }
+
+    void reset() {
+        for (int op = 0; op < MAX_OP; ++op) {
+            op_count_[op].store(0);
+            op_fail_count_[op].store(0);
+            op_time_us_[op].store(0);
+            for (int i = 0; i < LATENCY_BUCKET_NUM; ++i) {
+                latency_buckets_[op][i].store(0);
+            }
+        }
+        query_count_.store(0);
+        filtered_query_count_.store(0);
+        result_row_count_.store(0);
+        write_row_count_.store(0);
+        distance_count_.store(0);
+        recall_check_count_.store(0);
+        recall_hit_count_.store(0);
+        recall_expected_count_.store(0);
+        rejected_row_count_.store(0);
+    }
+
+    void record_op(IndexOpType op, int64_t elapsed_us, bool failed) {
+        int bucket = elapsed_us <= 0 ? 0 : 64 - __builtin_clzll(static_cast<uint64_t>(elapsed_us));
+        op_count_[op].fetch_add(1, std::memory_order_relaxed);
+        if (failed) {
+            op_fail_count_[op].fetch_add(1, std::memory_order_relaxed);
+        }
+        op_time_us_[op].fetch_add(elapsed_us, std::memory_order_relaxed);
+        latency_buckets_[op][std::min(bucket, LATENCY_BUCKET_NUM - 1)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void record_queries(int64_t query_count, bool filtered, int64_t result_rows) {
+        query_count_.fetch_add(query_count, std::memory_order_relaxed);
+        if (filtered) {
+            filtered_query_count_.fetch_add(query_count, std::memory_order_relaxed);
+        }
+        result_row_count_.fetch_add(result_rows, std::memory_order_relaxed);
+    }
+
+    void record_write_rows(int64_t rows) { write_row_count_.fetch_add(rows, std::memory_order_relaxed); }
+    void record_distances(int64_t count) { distance_count_.fetch_add(count, std::memory_order_relaxed); }
+    void record_rejected_rows(int64_t rows) { rejected_row_count_.fetch_add(rows, std::memory_order_relaxed); }
+    void record_recall(int64_t hit_count, int64_t expected_count) {
+        recall_check_count_.fetch_add(1, std::memory_order_relaxed);
+        recall_hit_count_.fetch_add(hit_count, std::memory_order_relaxed);
+        recall_expected_count_.fetch_add(expected_count, std::memory_order_relaxed);
+    }
+
+    void get(IndexStats& stats) const {
+        for (int op = 0; op < MAX_OP; ++op) {
+            stats.op_count_[op] = op_count_[op].load(std::memory_order_relaxed);
+            stats.op_fail_count_[op] = op_fail_count_[op].load(std::memory_order_relaxed);
+            stats.op_time_us_[op] = op_time_us_[op].load(std::memory_order_relaxed);
+            for (int i = 0; i < LATENCY_BUCKET_NUM; ++i) {
+                stats.latency_buckets_[op][i] = latency_buckets_[op][i].load(std::memory_order_relaxed);
+            }
+        }
+        stats.query_count_ = query_count_.load(std::memory_order_relaxed);
+        stats.filtered_query_count_ = filtered_query_count_.load(std::memory_order_relaxed);
+        stats.result_row_count_ = result_row_count_.load(std::memory_order_relaxed);
+        stats.write_row_count_ = write_row_count_.load(std::memory_order_relaxed);
+        stats.distance_count_ = distance_count_.load(std::memory_order_relaxed);
+        stats.recall_check_count_ = recall_check_count_.load(std::memory_order_relaxed);
+        stats.recall_hit_count_ = recall_hit_count_.load(std::memory_order_relaxed);
+        stats.recall_expected_count_ = recall_expected_count_.load(std::memory_order_relaxed);
+        stats.rejected_row_count_ = rejected_row_count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> op_count_[MAX_OP];
+    std::atomic<int64_t> op_fail_count_[MAX_OP];
+    std::atomic<int64_t> op_time_us_[MAX_OP];
+    std::atomic<int64_t> latency_buckets_[MAX_OP][LATENCY_BUCKET_NUM];
+    std::atomic<int64_t> query_count_;
+    std::atomic<int64_t> filtered_query_count_;
+    std::atomic<int64_t> result_row_count_;
+    std::atomic<int64_t> write_row_count_;
+    std::atomic<int64_t> distance_count_;
+    std::atomic<int64_t> recall_check_count_;
+    std::atomic<int64_t> recall_hit_count_;
+    std::atomic<int64_t> recall_expected_count_;
+    std::atomic<int64_t> rejected_row_count_;
+};
+
+// records one call of op into stats when it goes out of scope, ret is read at that time
+class ObOpRecorder
+{
+public:
+    ObOpRecorder(ObIndexStats& stats, IndexOpType op, const int& ret)
+        : stats_(stats), op_(op), ret_(ret), start_(std::chrono::steady_clock::now())
+    {}
+    ~ObOpRecorder() {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        stats_.record_op(op_, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(), ret_ != 0);
+    }
+private:
+    ObIndexStats& stats_;
+    IndexOpType op_;
+    const int& ret_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// reservoir sample of the vectors offered to it, every vector is kept with the same probability
+class ObVectorSampler
+{
+public:
+    explicit ObVectorSampler(int64_t capacity) : capacity_(capacity), seen_(0), size_(0) {}
+
+    void offer(const float* vectors, int64_t count, int dim) {
+        static thread_local std::mt19937_64 rng(std::random_device{}());
+        int64_t first = seen_.fetch_add(count, std::memory_order_relaxed);
+        for (int64_t i = 0; i < count; ++i) {
+            int64_t slot = first + i < capacity_ ? first + i : static_cast<int64_t>(rng() % (first + i + 1));
+            if (slot < capacity_) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (vectors_.empty()) {
+                    vectors_.resize(capacity_ * dim);
+                }
+                memcpy(vectors_.data() + slot * dim, vectors + i * dim, dim * sizeof(float));
+                size_ = std::max(size_, slot + 1);
+            }
+        }
+    }
+
+    // copy the sampled vectors into vectors and return their count
+    int64_t get(std::vector<float>& vectors, int dim) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        vectors.assign(vectors_.begin(), vectors_.begin() + size_ * dim);
+        return size_;
+    }
+
+private:
+    const int64_t capacity_;
+    std::atomic<int64_t> seen_;
+    std::mutex mutex_;
+    std::vector<float> vectors_;
+    int64_t size_;
 };
 
+// sampled vectors used as queries by one ef_search calibration
+static const int64_t CALIBRATION_QUERY_NUM = 64;
+// distances computed by the exact search of one recall check or calibration, see set_recall_check_budget
+static const int64_t DEFAULT_RECALL_CHECK_BUDGET = 16 << 20;
+static std::atomic<int64_t> recall_check_budget(DEFAULT_RECALL_CHECK_BUDGET);
+
+// rows written under one exclusive lock by writers that cannot run concurrently with searches
+static const int64_t INDEX_WRITE_CHUNK_SIZE = 256;
+
 class HnswIndexHandler
 {
 public:
@@ -83,7 +759,8 @@ public:
 
   HnswIndexHandler(bool is_create, bool is_build, bool use_static, const char* dtype, const char* metric, 
                    int max_degree, int ef_construction, int ef_search, int dim, IndexType index_type,
-                   std::shared_ptr<vsag::Index> index, vsag::Allocator* allocator, uint64_t extra_info_size):
+                   std::shared_ptr<vsag::Index> index, vsag::Allocator* allocator, uint64_t extra_info_size,
+                   int build_thread_count):
       is_created_(is_create),
       is_build_(is_build),
       use_static_(use_static),
@@ -94,25 +771,37 @@ public:
       ef_search_(ef_search),
       dim_(dim),
       index_type_(index_type),
-      index_(index),
+      snapshot_(std::make_shared<const IndexSnapshot>(IndexSnapshot{index, nullptr, 0})),
       allocator_(allocator),
-      extra_info_size_(extra_info_size)
+      extra_info_size_(extra_info_size),
+      build_thread_count_(build_thread_count),
+      index_build_thread_count_(clamp_build_thread_count(ObTaskScheduler::DEFAULT_TENANT_ID, build_thread_count)),
+      tenant_id_(ObTaskScheduler::DEFAULT_TENANT_ID),
+      index_lock_(HNSW_TYPE == index_type)
   {}
 
   ~HnswIndexHandler() {
-    index_ = nullptr;
-    vsag::logger::debug("   after deconstruction, hnsw index addr {} : use count {}", (void*)allocator_, index_.use_count());
+    wait_repair();
+    wait_recall_check();
+    wait_calibration();
+    snapshot_ = nullptr;
+    OB_VSAG_LOG_DEBUG("   after deconstruction, hnsw index addr {}", (void*)allocator_);
   }
   void set_build(bool is_build) { is_build_ = is_build;}
   bool is_build(bool is_build) { return is_build_;}
   int build_index(const vsag::DatasetPtr& base);
+  // build_thread_count only applies to this build, < 0 uses the one of create_index
+  int build_index(const vsag::DatasetPtr& base, int build_thread_count);
   int get_index_number();
   int add_index(const vsag::DatasetPtr& incremental);
+  int update_index(const float* vectors, const int64_t* ids, int dim, int size);
   int cal_distance_by_id(const float* vector, const int64_t* ids, int64_t count, const float*& dist);
   int get_extra_info_by_ids(const int64_t* ids, 
                             int64_t count, 
                             char *extra_infos);
   int get_vid_bound(int64_t &min_vid, int64_t &max_vid);
+  // ids scored by an exact search without filter, the vid range with its holes
+  int64_t get_scan_size();
   uint64_t estimate_memory(uint64_t row_count);
   int knn_search(const vsag::DatasetPtr& query, int64_t topk,
                 const std::string& parameters,
@@ -127,8 +816,53 @@ public:
                 FilterInterface *bitmap, bool reverse_filter,
                 bool need_extra_info, const char*& extra_infos,
                 void *&iter_ctx, bool is_last_search);
-  std::shared_ptr<vsag::Index>& get_index() {return index_;}
-  void set_index(std::shared_ptr<vsag::Index> hnsw) {index_ = hnsw;}
+  int knn_search_into(const vsag::DatasetPtr& query, int64_t topk,
+                      const std::string& parameters,
+                      float* dist, int64_t* ids, int64_t &result_size,
+                      float valid_ratio, FilterInterface *bitmap, bool reverse_filter,
+                      bool need_extra_info, char* extra_infos);
+  int range_search(const vsag::DatasetPtr& query, float radius, int64_t limit,
+                   const std::string& parameters,
+                   float* dist, int64_t* ids, int64_t &result_size,
+                   float valid_ratio, FilterInterface *bitmap, bool reverse_filter,
+                   bool need_extra_info, char* extra_infos);
+  int knn_search_batch(const float* query_vectors, int dim, int64_t query_count,
+                       const int64_t* topks, const std::vector<const SearchPlan*>& plans,
+                       float* dists, int64_t* ids, int64_t* result_sizes,
+                       float valid_ratio, FilterInterface** bitmaps, int64_t filter_count,
+                       bool reverse_filter, bool need_extra_info, char* extra_infos,
+                       int thread_num);
+  int exact_search(const float* query_vectors, int64_t query_count, int64_t topk,
+                   FilterInterface* bitmap, bool reverse_filter, int thread_num,
+                   float* dists, int64_t* ids, int64_t* result_sizes);
+  FilterPlan plan_filter(FilterInterface* bitmap, bool reverse_filter, float valid_ratio, bool use_extra_info_filter);
+  int exact_scan(const float* query_vector, int64_t topk, FilterInterface* bitmap, bool reverse_filter,
+                 float* dist, int64_t* ids, int64_t& result_size, char* extra_infos);
+  int exact_scan(const float* query_vector, int64_t topk, FilterInterface* bitmap, bool reverse_filter,
+                 const float*& dist, const int64_t*& ids, int64_t& result_size,
+                 bool need_extra_info, const char*& extra_infos);
+  int evaluate_recall(const float* query_vectors, int64_t query_count, int64_t topk, int ef_search,
+                      FilterInterface* bitmap, bool reverse_filter, int thread_num,
+                      int64_t& hit_count, int64_t& expected_count);
+  void set_recall_monitor(int64_t sample_interval, float min_recall);
+  void sample_recall(const float* query_vector, int64_t topk, const int64_t* ids, int64_t result_size);
+  void wait_recall_check();
+  void set_recall_target(float target_recall);
+  int resolve_ef_search(int ef_search, int64_t topk);
+  void sample_query(const float* query_vector);
+  void sample_rows(const float* vectors, int64_t count);
+  void schedule_calibration();
+  void wait_calibration();
+  // readers pin the current index and its tombstones, a new snapshot is published without waiting for them
+  IndexSnapshotPtr get_snapshot() {return std::atomic_load(&snapshot_);}
+  std::shared_ptr<vsag::Index> get_index() {return get_snapshot()->index_;}
+  // replace the index of a build that has not started, its tombstones are kept
+  void set_index(std::shared_ptr<vsag::Index> hnsw);
+  // replace the index and its tombstones by a loaded one, tuned ef_search values are dropped
+  void load_index(std::shared_ptr<vsag::Index> hnsw, const TombstoneSnapshot& tombstones);
+  int swap_index(HnswIndexHandler& other);
+  ObIndexLock& get_index_lock() {return index_lock_;}
+  ObIndexStats& get_stats() {return stats_;}
   vsag::Allocator* get_allocator() {return allocator_;}
   inline bool get_use_static() {return use_static_;}
   inline int get_max_degree() {return max_degree_;}
@@ -139,8 +873,41 @@ public:
   inline int get_ef_search() {return ef_search_;}
   inline int get_dim() {return dim_;}
   inline uint64_t get_extra_info_size() {return extra_info_size_;}
+  inline int get_build_thread_count() {return build_thread_count_;}
+  inline bool is_int8() {return 0 == strcmp(dtype_, "int8");}
+  int check_vectors(const vsag::DatasetPtr& dataset);
+  int check_float_vectors();
+  void set_index_build_thread_count(int thread_count) {index_build_thread_count_.store(thread_count);}
+  inline int64_t get_tenant_id() {return tenant_id_;}
+  // mask of IngestFlag applied to the rows written by build_index/add_index
+  inline int get_ingest_flags() {return ingest_flags_.load(std::memory_order_relaxed);}
+  void set_ingest_flags(int flags) {ingest_flags_.store(flags, std::memory_order_relaxed);}
+  void set_tenant_id(int64_t tenant_id) {tenant_id_ = tenant_id;}
+  const std::string& get_precise_file_path() {return precise_file_path_;}
+  int remove_index(const int64_t* ids, int64_t count);
+  uint64_t get_tombstones(TombstoneSnapshot& tombstones);
+  void schedule_repair();
+  void wait_repair();
+  void set_precise_file_path(const std::string& file_path) {precise_file_path_ = file_path;}
+  const SearchPlan* get_search_plan(int ef_search, bool use_extra_info_filter, float skip_ratio = DEFAULT_SKIP_RATIO);
   
 private:
+  vsag::FilterPtr make_search_filter(FilterInterface *bitmap, bool reverse_filter, float valid_ratio,
+                                     const IndexSnapshot& snapshot);
+  void publish(const std::shared_ptr<vsag::Index>& index, const TombstoneSnapshot& tombstones);
+  void remove_from_tombstones(const uint64_t* ids, int64_t count);
+  void repair_tombstones();
+  int build_with_threads(const vsag::DatasetPtr& base, int build_thread_count);
+  void calibrate_ef_search();
+  int exact_search(const IndexSnapshot& snapshot, const float* query_vectors, int64_t query_count, int64_t topk,
+                   FilterInterface* bitmap, bool reverse_filter, int thread_num,
+                   float* dists, int64_t* ids, int64_t* result_sizes);
+  int exact_scan(const IndexSnapshot& snapshot, const float* query_vector, int64_t topk, FilterInterface* bitmap,
+                 bool reverse_filter, float* dist, int64_t* ids, int64_t& result_size, char* extra_infos);
+  int score_rows(const IndexSnapshot& snapshot, const float* query_vectors, int64_t query_count,
+                 int64_t* ids, int64_t count, std::vector<ObTopkHeap>& heaps);
+  void clear_tombstones(const int64_t* ids, int64_t count);
+
   bool is_created_;
   bool is_build_;
   bool use_static_;
@@ -151,32 +918,166 @@ private:
   int ef_search_;
   int dim_;
   IndexType index_type_;
-  std::shared_ptr<vsag::Index> index_;
+  IndexSnapshotPtr snapshot_;
   vsag::Allocator* allocator_;
   uint64_t extra_info_size_;
+  int build_thread_count_;
+  // build_thread_count the hgraph index was created with, after clamping
+  std::atomic<int> index_build_thread_count_;
+  int64_t tenant_id_;
+  ObIndexLock index_lock_;
+  ObIndexStats stats_;
+  std::string precise_file_path_;
+  // serializes publishing snapshot_ and guards repair_failed_ids_
+  std::mutex snapshot_mutex_;
+  // tombstoned ids vsag failed to remove, kept masked and skipped by later repairs
+  std::unordered_set<int64_t> repair_failed_ids_;
+  // serializes removing a tombstoned row from the index with clearing its tombstone
+  std::mutex tombstone_remove_mutex_;
+  std::mutex repair_mutex_;
+  std::condition_variable repair_cond_;
+  bool repair_running_ = false;
+  bool repair_pending_ = false;
+  bool repair_supported_ = true;
+  std::atomic<int64_t> recall_sample_interval_{0};
+  std::atomic<int64_t> recall_query_seq_{0};
+  std::atomic<float> min_recall_{0};
+  std::mutex recall_mutex_;
+  std::condition_variable recall_cond_;
+  bool recall_running_ = false;
+  std::atomic<float> recall_target_{0};
+  std::atomic<int> ingest_flags_{0};
+  ObVectorSampler query_sampler_{CALIBRATION_QUERY_NUM};
+  ObVectorSampler row_sampler_{CALIBRATION_QUERY_NUM};
+  // smallest ef_search meeting recall_target_ by topk, replaced as a whole by calibrate_ef_search
+  std::shared_ptr<const std::map<int64_t, int>> tuned_ef_searches_;
+  std::mutex calibration_mutex_;
+  std::condition_variable calibration_cond_;
+  std::set<int64_t> tuned_topks_{10};
+  bool calibration_running_ = false;
+  bool calibration_pending_ = false;
+  std::atomic<int64_t> calibrated_rows_{0};
+  std::shared_mutex search_plan_mutex_;
+  std::map<std::tuple<int, bool, float>, std::unique_ptr<SearchPlan>> search_plans_;
 };
 
-int HnswIndexHandler::build_index(const vsag::DatasetPtr& base) 
-{
-    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
-    if (const auto num = index_->Build(base); num.has_value()) {
-        return 0;
-    } else {
-        error = num.error().type;
+SlowTaskTimer::SlowTaskTimer(IndexOpType o, HnswIndexHandler* h, const int& r)
+    : op(o), hnsw(h), ret(r), threshold(slow_log_configs[o].threshold_us_.load(std::memory_order_relaxed)) {
+    if (threshold >= 0) {
+        start = std::chrono::steady_clock::now();
     }
-    return static_cast<int>(error);
-}
-
-int HnswIndexHandler::get_index_number() 
-{
-    return index_->GetNumElements();
 }
 
-int HnswIndexHandler::add_index(const vsag::DatasetPtr& incremental) 
+SlowTaskTimer::~SlowTaskTimer() {
+    if (threshold < 0) {
+        return;
+    }
+    auto finish = std::chrono::steady_clock::now();
+    int64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(finish - start).count();
+    SlowLogConfig& config = slow_log_configs[op];
+    if (elapsed_us < threshold
+        || config.slow_count_.fetch_add(1, std::memory_order_relaxed) % config.sample_interval_.load(std::memory_order_relaxed) != 0) {
+        return;
+    }
+    std::shared_ptr<vsag::Index> index = hnsw->get_index();
+    int64_t element_count = index == nullptr ? 0 : index->GetNumElements();
+    if (SEARCH_OP == op || SEARCH_BATCH_OP == op) {
+        vsag::logger::warn("   slow {} cost {}us, ret={}, index_type={}, element_count={}, topk={}, "
+                           "ef_search={}, filtered={}, valid_ratio={}, result_size={}",
+                           OP_NAMES[op], elapsed_us, ret, hnsw->get_index_type(), element_count, topk,
+                           ef_search, filtered, valid_ratio, rows);
+    } else {
+        vsag::logger::warn("   slow {} cost {}us, ret={}, index_type={}, element_count={}, rows={}",
+                           OP_NAMES[op], elapsed_us, ret, hnsw->get_index_type(), element_count, rows);
+    }
+}
+
+const SearchPlan* HnswIndexHandler::get_search_plan(int ef_search, bool use_extra_info_filter, float skip_ratio)
+{
+    const auto key = std::make_tuple(ef_search, use_extra_info_filter, skip_ratio);
+    {
+        std::shared_lock<std::shared_mutex> lock(search_plan_mutex_);
+        auto iter = search_plans_.find(key);
+        if (iter != search_plans_.end()) {
+            return iter->second.get();
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(search_plan_mutex_);
+    auto& plan = search_plans_[key];
+    if (plan == nullptr) {
+        plan.reset(new SearchPlan(index_type_, ef_search, use_extra_info_filter, skip_ratio));
+        OB_VSAG_LOG_DEBUG("   create search plan, parameters:{}", plan->parameters_);
+    }
+    return plan.get();
+}
+
+// rows inserted by one Add of a parallel hnsw build
+static const int64_t HNSW_PARALLEL_BUILD_BLOCK_SIZE = 1024;
+
+// an int8 index takes int8 rows and queries, the other indexes fp32 ones
+int HnswIndexHandler::check_vectors(const vsag::DatasetPtr& dataset)
 {
+    if (is_int8() == (dataset->GetInt8Vectors() == nullptr)) {
+        vsag::logger::error("   vectors of another type than the index dtype {}", dtype_);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    }
+    return 0;
+}
+
+int HnswIndexHandler::check_float_vectors()
+{
+    if (is_int8()) {
+        vsag::logger::error("   fp32 vectors given to an int8 index");
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    }
+    return 0;
+}
+
+int HnswIndexHandler::build_index(const vsag::DatasetPtr& base) 
+{
+    return build_index(base, -1);
+}
+
+int HnswIndexHandler::build_with_threads(const vsag::DatasetPtr& base, int build_thread_count)
+{
+    std::lock_guard<ObIndexLock> guard(index_lock_);
+    std::shared_ptr<vsag::Index> index = get_index();
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
-    if (const auto num = index_->Add(incremental); num.has_value()) {
-        vsag::logger::debug(" after add index, index count {}", get_index_number());
+    const int64_t num_elements = base->GetNumElements();
+    // only a plain fp32 hnsw takes concurrent Adds: static hnsw is built in one pass, the hgraph
+    // types (HNSW_SQ_TYPE, HNSW_BQ_TYPE, HGRAPH_TYPE) use their own build_thread_count
+    const bool parallel_build = HNSW_TYPE == index_type_ && !use_static_
+                                && base->GetFloat32Vectors() != nullptr && base->GetExtraInfos() == nullptr;
+    if (parallel_build && build_thread_count > 1 && num_elements > HNSW_PARALLEL_BUILD_BLOCK_SIZE) {
+        // hnsw has no build thread parameter, build the first block and insert the rest concurrently
+        auto make_block = [&](int64_t start, int64_t count) {
+            auto block = vsag::Dataset::Make();
+            block->Dim(dim_)
+                 ->NumElements(count)
+                 ->Ids(base->GetIds() + start)
+                 ->Float32Vectors(base->GetFloat32Vectors() + start * dim_)
+                 ->Owner(false);
+            return block;
+        };
+        if (const auto num = index->Build(make_block(0, HNSW_PARALLEL_BUILD_BLOCK_SIZE)); !num.has_value()) {
+            return static_cast<int>(num.error().type);
+        }
+        const int64_t block_count = (num_elements - 1) / HNSW_PARALLEL_BUILD_BLOCK_SIZE;
+        std::atomic<int> first_error(0);
+        ObTaskScheduler::instance().parallel_for(tenant_id_, block_count, build_thread_count, [&](int64_t i) {
+            if (first_error.load(std::memory_order_relaxed) != 0) {
+                return;
+            }
+            const int64_t start = (i + 1) * HNSW_PARALLEL_BUILD_BLOCK_SIZE;
+            const int64_t count = std::min(HNSW_PARALLEL_BUILD_BLOCK_SIZE, num_elements - start);
+            if (const auto num = index->Add(make_block(start, count)); !num.has_value()) {
+                int expected = 0;
+                first_error.compare_exchange_strong(expected, static_cast<int>(num.error().type));
+            }
+        });
+        return first_error.load();
+    }
+    if (const auto num = index->Build(base); num.has_value()) {
         return 0;
     } else {
         error = num.error().type;
@@ -184,10 +1085,123 @@ int HnswIndexHandler::add_index(const vsag::DatasetPtr& incremental)
     return static_cast<int>(error);
 }
 
+int HnswIndexHandler::build_index(const vsag::DatasetPtr& base, int build_thread_count)
+{
+    if (int check_ret = check_vectors(base); check_ret != 0) {
+        return check_ret;
+    }
+    if (build_thread_count < 0) {
+        build_thread_count = build_thread_count_;
+    }
+    // hgraph takes build_thread_count at creation, clamped to the tenant assigned at that time,
+    // recreate the still empty index when the value or the limits of the tenant changed since
+    const int index_build_thread_count = clamp_build_thread_count(tenant_id_, build_thread_count);
+    if (HNSW_TYPE != index_type_ && index_build_thread_count != index_build_thread_count_.load()) {
+        if (get_index()->GetNumElements() != 0) {
+            OB_VSAG_LOG_DEBUG("   index is not empty, keep build_thread_count:{}", index_build_thread_count_.load());
+            return build_with_threads(base, build_thread_count_);
+        }
+        nlohmann::json index_parameters = make_index_parameters(index_type_, dtype_, metric_, dim_, max_degree_,
+                                                                ef_construction_, ef_search_, use_static_,
+                                                                extra_info_size_, build_thread_count, tenant_id_);
+        if (auto new_index = vsag::Factory::CreateIndex(get_index_type_str(index_type_), index_parameters.dump(), allocator_);
+            new_index.has_value()) {
+            set_index(new_index.value());
+            index_build_thread_count_.store(index_build_thread_count);
+        } else {
+            return static_cast<int>(new_index.error().type);
+        }
+    }
+    // build_thread_count_ is left as is, later builds and deserialize keep the value of create_index
+    return build_with_threads(base, build_thread_count);
+}
+
+int HnswIndexHandler::get_index_number() 
+{
+    return get_index()->GetNumElements();
+}
+
+int HnswIndexHandler::add_index(const vsag::DatasetPtr& incremental) 
+{
+    if (int check_ret = check_vectors(incremental); check_ret != 0) {
+        return check_ret;
+    }
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    const int64_t num_elements = incremental->GetNumElements();
+    clear_tombstones(incremental->GetIds(), num_elements);
+    // searches run between chunks, rows of a chunk become visible together
+    for (int64_t start = 0; start < num_elements; start += INDEX_WRITE_CHUNK_SIZE) {
+        const int64_t count = std::min(INDEX_WRITE_CHUNK_SIZE, num_elements - start);
+        auto chunk = incremental;
+        if (count != num_elements) {
+            chunk = vsag::Dataset::Make();
+            chunk->Dim(dim_)
+                ->NumElements(count)
+                ->Ids(incremental->GetIds() + start)
+                ->Float32Vectors(incremental->GetFloat32Vectors() + start * dim_)
+                ->Owner(false);
+            if (incremental->GetExtraInfos() != nullptr) {
+                chunk->ExtraInfos(incremental->GetExtraInfos() + start * extra_info_size_);
+            }
+        }
+        std::lock_guard<ObIndexLock> guard(index_lock_);
+        if (const auto num = get_index()->Add(chunk); !num.has_value()) {
+            error = num.error().type;
+            return static_cast<int>(error);
+        }
+    }
+    OB_VSAG_LOG_DEBUG(" after add index, index count {}", get_index_number());
+    return 0;
+}
+
+int HnswIndexHandler::update_index(const float* vectors, const int64_t* ids, int dim, int size)
+{
+    if (int check_ret = check_float_vectors(); check_ret != 0) {
+        return check_ret;
+    }
+    int64_t local_update_count = 0;
+    std::unique_lock<ObIndexLock> guard(index_lock_);
+    std::shared_ptr<vsag::Index> index = get_index();
+    for (int i = 0; i < size; ++i) {
+        if (i > 0 && i % INDEX_WRITE_CHUNK_SIZE == 0) {
+            guard.unlock();
+            guard.lock();
+            index = get_index();
+        }
+        auto vector = vsag::Dataset::Make();
+        vector->Dim(dim)
+            ->NumElements(1)
+            ->Float32Vectors(vectors + static_cast<int64_t>(i) * dim)
+            ->Owner(false);
+        // vsag refuses the local repair when the new vector moved too far from its old
+        // neighborhood, the forced update then relinks the row like a new insert
+        auto result = index->UpdateVector(ids[i], vector, false);
+        if (result.has_value() && result.value()) {
+            ++local_update_count;
+            continue;
+        } else if (result.has_value()) {
+            result = index->UpdateVector(ids[i], vector, true);
+        }
+        if (!result.has_value()) {
+            vsag::logger::error("   update vector fail, id:{}, ret={}", ids[i], static_cast<int>(result.error().type));
+            return static_cast<int>(result.error().type);
+        } else if (!result.value()) {
+            vsag::logger::error("   update vector fail, id:{}", ids[i]);
+            return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+        }
+    }
+    OB_VSAG_LOG_DEBUG("   update count:{}, local update count:{}", size, local_update_count);
+    return 0;
+}
+
 int HnswIndexHandler::cal_distance_by_id(const float* vector, const int64_t* ids, int64_t count, const float*& dist)
 {
+    if (int check_ret = check_float_vectors(); check_ret != 0) {
+        return check_ret;
+    }
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
-    auto result = index_->CalDistanceById(vector, ids, count);
+    std::shared_lock<ObIndexLock> guard(index_lock_);
+    auto result = get_index()->CalDistanceById(vector, ids, count);
     if (result.has_value()) {
         result.value()->Owner(false);
         dist = result.value()->GetDistances();
@@ -202,18 +1216,21 @@ int HnswIndexHandler::get_extra_info_by_ids(const int64_t* ids,
                                             int64_t count, 
                                             char *extra_infos)
 {
-    index_->GetExtraInfoByIds(ids, count, extra_infos);
+    std::shared_lock<ObIndexLock> guard(index_lock_);
+    get_index()->GetExtraInfoByIds(ids, count, extra_infos);
     return 0;
 }
 
 int HnswIndexHandler::get_vid_bound(int64_t &min_vid, int64_t &max_vid)
 {
+    std::shared_lock<ObIndexLock> guard(index_lock_);
+    std::shared_ptr<vsag::Index> index = get_index();
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
-    int64_t element_cnt = index_->GetNumElements();
+    int64_t element_cnt = index->GetNumElements();
     if (element_cnt == 0) {
         return 0;
     } else {
-        auto result = index_->GetMinAndMaxId();
+        auto result = index->GetMinAndMaxId();
         if (result.has_value()) {
             min_vid = result.value().first;
             max_vid = result.value().second;
@@ -225,9 +1242,270 @@ int HnswIndexHandler::get_vid_bound(int64_t &min_vid, int64_t &max_vid)
     return static_cast<int>(error);
 }
 
+int64_t HnswIndexHandler::get_scan_size()
+{
+    int64_t min_vid = 0;
+    int64_t max_vid = -1;
+    if (get_vid_bound(min_vid, max_vid) != 0) {
+        return 0;
+    }
+    return max_vid - min_vid + 1;
+}
+
 uint64_t HnswIndexHandler::estimate_memory(uint64_t row_count)
 {
-    return index_->EstimateMemory(row_count);
+    return get_index()->EstimateMemory(row_count);
+}
+
+// publish the index of other here and the current one in other, searches already running
+// on either handler finish on the index they started with
+int HnswIndexHandler::swap_index(HnswIndexHandler& other)
+{
+    if (index_type_ != other.index_type_ || dim_ != other.dim_ || extra_info_size_ != other.extra_info_size_
+        || 0 != strcmp(dtype_, other.dtype_) || 0 != strcmp(metric_, other.metric_)) {
+        vsag::logger::error("   swap index with different parameters, index_type:{}/{}, dim:{}/{}",
+                            static_cast<int>(index_type_), static_cast<int>(other.index_type_), dim_, other.dim_);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    }
+    // both handlers in address order, so that two swaps of the same pair cannot deadlock
+    HnswIndexHandler* first = this < &other ? this : &other;
+    HnswIndexHandler* second = this < &other ? &other : this;
+    {
+        ObPublishGuard first_guard(first->index_lock_);
+        ObPublishGuard second_guard(second->index_lock_);
+        std::lock_guard<std::mutex> first_lock(first->snapshot_mutex_);
+        std::lock_guard<std::mutex> second_lock(second->snapshot_mutex_);
+        // removed rows and tuned ef_search values belong to the index and move with it
+        IndexSnapshotPtr snapshot = get_snapshot();
+        std::atomic_store(&snapshot_, other.get_snapshot());
+        std::atomic_store(&other.snapshot_, snapshot);
+        repair_failed_ids_.swap(other.repair_failed_ids_);
+        auto tuned_ef_searches = std::atomic_load(&tuned_ef_searches_);
+        std::atomic_store(&tuned_ef_searches_, std::atomic_load(&other.tuned_ef_searches_));
+        std::atomic_store(&other.tuned_ef_searches_, tuned_ef_searches);
+        calibrated_rows_.store(other.calibrated_rows_.exchange(calibrated_rows_.load()));
+        index_build_thread_count_.store(other.index_build_thread_count_.exchange(index_build_thread_count_.load()));
+    }
+    schedule_repair();
+    other.schedule_repair();
+    return 0;
+}
+
+uint64_t HnswIndexHandler::get_tombstones(TombstoneSnapshot& tombstones)
+{
+    IndexSnapshotPtr snapshot = get_snapshot();
+    tombstones = snapshot->tombstones_;
+    return snapshot->tombstone_count_;
+}
+
+// caller holds snapshot_mutex_
+void HnswIndexHandler::publish(const std::shared_ptr<vsag::Index>& index, const TombstoneSnapshot& tombstones)
+{
+    uint64_t count = tombstones == nullptr ? 0 : roaring::api::roaring64_bitmap_get_cardinality(tombstones.get());
+    std::atomic_store(&snapshot_, std::make_shared<const IndexSnapshot>(
+        IndexSnapshot{index, count == 0 ? nullptr : tombstones, count}));
+}
+
+void HnswIndexHandler::set_index(std::shared_ptr<vsag::Index> hnsw)
+{
+    ObPublishGuard guard(index_lock_);
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    publish(hnsw, get_snapshot()->tombstones_);
+}
+
+void HnswIndexHandler::load_index(std::shared_ptr<vsag::Index> hnsw, const TombstoneSnapshot& tombstones)
+{
+    {
+        ObPublishGuard guard(index_lock_);
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        publish(hnsw, tombstones);
+        repair_failed_ids_.clear();
+        std::atomic_store(&tuned_ef_searches_, std::shared_ptr<const std::map<int64_t, int>>());
+        calibrated_rows_.store(0);
+    }
+    schedule_repair();
+    if (recall_target_.load() > 0) {
+        schedule_calibration();
+    }
+}
+
+vsag::FilterPtr HnswIndexHandler::make_search_filter(FilterInterface *bitmap, bool reverse_filter, float valid_ratio,
+                                                     const IndexSnapshot& snapshot)
+{
+    if (snapshot.tombstones_ == nullptr) {
+        return make_vsag_filter(bitmap, reverse_filter, valid_ratio);
+    }
+    int64_t num_elements = snapshot.index_->GetNumElements();
+    if (num_elements > 0) {
+        valid_ratio *= std::max(0.0f, 1.0f - static_cast<float>(snapshot.tombstone_count_) / num_elements);
+    }
+    return std::make_shared<ObTombstoneVsagFilter>(valid_ratio, snapshot.tombstones_,
+                                                   make_vsag_filter(bitmap, reverse_filter, valid_ratio));
+}
+
+int HnswIndexHandler::remove_index(const int64_t* ids, int64_t count)
+{
+    {
+        // a swap or load publishes under the same mutex, the ids are added to the index they were removed from
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        IndexSnapshotPtr snapshot = get_snapshot();
+        roaring::api::roaring64_bitmap_t* bitmap = snapshot->tombstones_ == nullptr
+            ? roaring::api::roaring64_bitmap_create()
+            : roaring::api::roaring64_bitmap_copy(snapshot->tombstones_.get());
+        if (bitmap == nullptr) {
+            return static_cast<int>(vsag::ErrorType::NO_ENOUGH_MEMORY);
+        }
+        roaring::api::roaring64_bitmap_add_many(bitmap, count, reinterpret_cast<const uint64_t*>(ids));
+        publish(snapshot->index_, make_tombstone_snapshot(bitmap));
+        OB_VSAG_LOG_DEBUG("   tombstone count:{}", get_snapshot()->tombstone_count_);
+    }
+    schedule_repair();
+    return 0;
+}
+
+// drop ids from the tombstones, caller holds snapshot_mutex_
+void HnswIndexHandler::remove_from_tombstones(const uint64_t* ids, int64_t count)
+{
+    IndexSnapshotPtr snapshot = get_snapshot();
+    roaring::api::roaring64_bitmap_t* bitmap = snapshot->tombstones_ == nullptr
+        ? nullptr : roaring::api::roaring64_bitmap_copy(snapshot->tombstones_.get());
+    if (bitmap == nullptr) {
+        return;
+    }
+    roaring::api::roaring64_bitmap_remove_many(bitmap, count, ids);
+    publish(snapshot->index_, make_tombstone_snapshot(bitmap));
+}
+
+// a removed id added again is visible again. The old rows of the re-inserted ids are
+// removed here, the repair task skips ids no longer tombstoned, so it never removes the
+// new row and inserts do not wait for a repair pass.
+void HnswIndexHandler::clear_tombstones(const int64_t* ids, int64_t count)
+{
+    TombstoneSnapshot tombstones;
+    if (get_tombstones(tombstones) == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> remove_guard(tombstone_remove_mutex_);
+    // no swap or load while the writer lock is held, the index and the ids tombstoned in it stay
+    std::lock_guard<ObIndexLock> guard(index_lock_);
+    IndexSnapshotPtr snapshot = get_snapshot();
+    std::vector<uint64_t> cleared;
+    for (int64_t i = 0; snapshot->tombstones_ != nullptr && i < count; ++i) {
+        if (roaring::api::roaring64_bitmap_contains(snapshot->tombstones_.get(), ids[i])) {
+            cleared.push_back(ids[i]);
+        }
+    }
+    if (cleared.empty()) {
+        return;
+    }
+    for (uint64_t id : cleared) {
+        // fails for rows already removed by the repair task or types without remove
+        snapshot->index_->Remove(static_cast<int64_t>(id));
+    }
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    remove_from_tombstones(cleared.data(), cleared.size());
+    for (uint64_t id : cleared) {
+        repair_failed_ids_.erase(static_cast<int64_t>(id));
+    }
+}
+
+void HnswIndexHandler::schedule_repair()
+{
+    {
+        std::lock_guard<std::mutex> lock(repair_mutex_);
+        if (!repair_supported_) {
+            return;
+        } else if (repair_running_) {
+            repair_pending_ = true;
+            return;
+        }
+        repair_running_ = true;
+    }
+    ObTaskScheduler::instance().submit(get_tenant_id(), [this]() { repair_tombstones(); }, [this]() {
+        // no thread can run it, the tombstones keep masking the rows until the next schedule
+        std::lock_guard<std::mutex> lock(repair_mutex_);
+        repair_running_ = false;
+        repair_pending_ = false;
+        repair_cond_.notify_all();
+    });
+}
+
+void HnswIndexHandler::wait_repair()
+{
+    std::unique_lock<std::mutex> lock(repair_mutex_);
+    repair_cond_.wait(lock, [this]() { return !repair_running_; });
+}
+
+// remove tombstoned rows from the index, which unlinks them from the graph and reconnects
+// their neighbors, rows it cannot remove stay masked by the tombstones
+void HnswIndexHandler::repair_tombstones()
+{
+    while (true) {
+        // a pass repairs one index, one swapped or loaded in is repaired by the pass scheduled with it
+        IndexSnapshotPtr pass_snapshot = get_snapshot();
+        const std::shared_ptr<vsag::Index>& index = pass_snapshot->index_;
+        const TombstoneSnapshot& tombstones = pass_snapshot->tombstones_;
+        std::vector<uint64_t> removed;
+        std::vector<int64_t> failed;
+        bool supported = true;
+        if (tombstones != nullptr) {
+            roaring::api::roaring64_iterator_t* iter = roaring::api::roaring64_iterator_create(tombstones.get());
+            for (; roaring::api::roaring64_iterator_has_value(iter); roaring::api::roaring64_iterator_advance(iter)) {
+                int64_t id = static_cast<int64_t>(roaring::api::roaring64_iterator_value(iter));
+                std::lock_guard<std::mutex> remove_guard(tombstone_remove_mutex_);
+                std::lock_guard<ObIndexLock> guard(index_lock_);
+                IndexSnapshotPtr snapshot = get_snapshot();
+                if (snapshot->index_ != index) {
+                    break;
+                }
+                {
+                    // skip ids cleared by a re-insert since the snapshot and ids failing before
+                    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+                    if (snapshot->tombstones_ == nullptr
+                        || !roaring::api::roaring64_bitmap_contains(snapshot->tombstones_.get(), id)
+                        || repair_failed_ids_.count(id) != 0) {
+                        continue;
+                    }
+                }
+                if (auto result = index->Remove(id); result.has_value()) {
+                    removed.push_back(id);
+                } else if (result.error().type == vsag::ErrorType::UNSUPPORTED_INDEX_OPERATION) {
+                    vsag::logger::info("   index does not support remove, keep tombstones, index_type:{}", static_cast<int>(index_type_));
+                    supported = false;
+                    break;
+                } else {
+                    // e.g. an id never inserted, it stays masked and the repair goes on with the next ids
+                    vsag::logger::warn("   remove tombstoned row fail, id:{}, ret={}", id, static_cast<int>(result.error().type));
+                    failed.push_back(id);
+                }
+            }
+            roaring::api::roaring64_iterator_free(iter);
+        }
+        if (!removed.empty() || !failed.empty()) {
+            // rows removed from an index swapped out since stay masked in it, a later repair skips them
+            std::lock_guard<std::mutex> lock(snapshot_mutex_);
+            if (get_index() == index) {
+                remove_from_tombstones(removed.data(), removed.size());
+                IndexSnapshotPtr current = get_snapshot();
+                for (int64_t id : failed) {
+                    if (current->tombstones_ != nullptr
+                        && roaring::api::roaring64_bitmap_contains(current->tombstones_.get(), id)) {
+                        repair_failed_ids_.insert(id);
+                    }
+                }
+            }
+        }
+        OB_VSAG_LOG_DEBUG("   repair tombstones, removed:{}, failed:{}", removed.size(), failed.size());
+        std::lock_guard<std::mutex> lock(repair_mutex_);
+        repair_supported_ = supported;
+        if (supported && repair_pending_) {
+            repair_pending_ = false;
+            continue;
+        }
+        repair_running_ = false;
+        repair_cond_.notify_all();
+        return;
+    }
 }
 
 int HnswIndexHandler::knn_search(const vsag::DatasetPtr& query, int64_t topk,
@@ -236,26 +1514,19 @@ int HnswIndexHandler::knn_search(const vsag::DatasetPtr& query, int64_t topk,
                float valid_ratio, int index_type,
                FilterInterface *bitmap, bool reverse_filter,
                bool need_extra_info, const char*& extra_infos) {
-    vsag::logger::debug("  search_parameters:{}", parameters);
-    vsag::logger::debug("  topk:{}", topk);
+    if (int check_ret = check_vectors(query); check_ret != 0) {
+        return check_ret;
+    }
+    OB_VSAG_LOG_DEBUG("  search_parameters:{}", parameters);
+    OB_VSAG_LOG_DEBUG("  topk:{}", topk);
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
-    auto vid_filter = [bitmap, reverse_filter](int64_t id) -> bool {
-        if (!reverse_filter) {
-            return bitmap->test(id);
-        } else {
-            return !(bitmap->test(id));
-        }
-    };
-    auto exinfo_filter = [bitmap, reverse_filter](const char* data) -> bool {
-        if (!reverse_filter) {
-            return bitmap->test(data);
-        } else {
-            return !(bitmap->test(data));
-        }
-    };
     tl::expected<std::shared_ptr<vsag::Dataset>, vsag::Error> result;
-    auto vsag_filter = std::make_shared<ObVasgFilter>(valid_ratio, vid_filter, exinfo_filter);
-    result = index_->KnnSearch(query, topk, parameters, bitmap == nullptr ? nullptr : vsag_filter);
+    std::shared_lock<ObIndexLock> guard(index_lock_);
+    IndexSnapshotPtr snapshot = get_snapshot();
+    auto vsag_filter = make_search_filter(bitmap, reverse_filter, valid_ratio, *snapshot);
+    result = search_live_rows(*snapshot, topk, extra_info_size_, [&](int64_t fetch) {
+        return snapshot->index_->KnnSearch(query, fetch, parameters, vsag_filter);
+    });
     if (result.has_value()) {
         //result的生命周期
         result.value()->Owner(false);
@@ -280,27 +1551,19 @@ int HnswIndexHandler::knn_search(const vsag::DatasetPtr& query, int64_t topk,
                FilterInterface *bitmap, bool reverse_filter,
                bool need_extra_info, const char*& extra_infos,
                void *&iter_ctx, bool is_last_search) {
-    vsag::logger::debug("  search_parameters:{}", parameters);
-    vsag::logger::debug("  topk:{}", topk);
+    if (int check_ret = check_vectors(query); check_ret != 0) {
+        return check_ret;
+    }
+    OB_VSAG_LOG_DEBUG("  search_parameters:{}", parameters);
+    OB_VSAG_LOG_DEBUG("  topk:{}", topk);
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
-    auto filter = [bitmap, reverse_filter](int64_t id) -> bool {
-        if (!reverse_filter) {
-            return bitmap->test(id);
-        } else {
-            return !(bitmap->test(id));
-        }
-    };
-    auto exinfo_filter = [bitmap, reverse_filter](const char* data) -> bool {
-        if (!reverse_filter) {
-            return bitmap->test(data);
-        } else {
-            return !(bitmap->test(data));
-        }
-    };
     tl::expected<std::shared_ptr<vsag::Dataset>, vsag::Error> result;
-    auto vsag_filter = std::make_shared<ObVasgFilter>(valid_ratio, filter, exinfo_filter);
     vsag::IteratorContext* input_iter = static_cast<vsag::IteratorContext*>(iter_ctx);
-    result = index_->KnnSearch(query, topk, parameters, bitmap == nullptr ? nullptr : vsag_filter, input_iter, is_last_search);
+    std::shared_lock<ObIndexLock> guard(index_lock_);
+    IndexSnapshotPtr snapshot = get_snapshot();
+    const TombstoneSnapshot& tombstones = snapshot->tombstones_;
+    auto vsag_filter = make_search_filter(bitmap, reverse_filter, valid_ratio, *snapshot);
+    result = snapshot->index_->KnnSearch(query, topk, parameters, vsag_filter, input_iter, is_last_search);
     if (result.has_value()) {
         iter_ctx = input_iter;
         result.value()->Owner(false);
@@ -310,6 +1573,14 @@ int HnswIndexHandler::knn_search(const vsag::DatasetPtr& query, int64_t topk,
         if (need_extra_info) {
             extra_infos = result.value()->GetExtraInfos();
         }
+        // the iterator cannot run the search again, rows removed are dropped from this page and
+        // the caller asks the next one for more
+        if (tombstones != nullptr) {
+            result_size = drop_tombstones(tombstones.get(), result_size, const_cast<float*>(dist),
+                                          const_cast<int64_t*>(ids),
+                                          need_extra_info ? const_cast<char*>(extra_infos) : nullptr,
+                                          extra_info_size_);
+        }
         return 0; 
     } else {
         error = result.error().type;
@@ -318,127 +1589,912 @@ int HnswIndexHandler::knn_search(const vsag::DatasetPtr& query, int64_t topk,
     return static_cast<int>(error);
 }
 
-bool is_init_ = vsag::init();
-
-void
-set_log_level(int32_t ob_level_num) {
-    std::map<int32_t, int32_t> ob2vsag_log_level = {
-        {0 /*ERROR*/, vsag::Logger::Level::kERR},
-        {1 /*WARN*/, vsag::Logger::Level::kWARN},
-        {2 /*INFO*/, vsag::Logger::Level::kINFO},
-        {3 /*EDIAG*/, vsag::Logger::Level::kERR},
-        {4 /*WDIAG*/, vsag::Logger::Level::kWARN},
-        {5 /*TRACE*/, vsag::Logger::Level::kTRACE},
-        {6 /*DEBUG*/, vsag::Logger::Level::kDEBUG},
-    };
-    vsag::Options::Instance().logger()->SetLevel(
-        static_cast<vsag::Logger::Level>(ob2vsag_log_level[ob_level_num]));
+int HnswIndexHandler::knn_search_into(const vsag::DatasetPtr& query, int64_t topk,
+                                      const std::string& parameters,
+                                      float* dist, int64_t* ids, int64_t &result_size,
+                                      float valid_ratio, FilterInterface *bitmap, bool reverse_filter,
+                                      bool need_extra_info, char* extra_infos) {
+    if (int check_ret = check_vectors(query); check_ret != 0) {
+        return check_ret;
+    }
+    OB_VSAG_LOG_DEBUG("  search_parameters:{}", parameters);
+    OB_VSAG_LOG_DEBUG("  topk:{}", topk);
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    std::shared_lock<ObIndexLock> guard(index_lock_);
+    IndexSnapshotPtr snapshot = get_snapshot();
+    auto vsag_filter = make_search_filter(bitmap, reverse_filter, valid_ratio, *snapshot);
+    auto result = search_live_rows(*snapshot, topk, extra_info_size_, [&](int64_t fetch) {
+        return snapshot->index_->KnnSearch(query, fetch, parameters, vsag_filter);
+    });
+    if (result.has_value()) {
+        result_size = copy_search_result(result.value(), topk, dist, ids,
+                                         need_extra_info ? extra_infos : nullptr, extra_info_size_);
+        return 0;
+    } else {
+        error = result.error().type;
+    }
+    return static_cast<int>(error);
 }
 
-bool is_init() {
-    vsag::logger::debug("TRACE LOG[Init VsagLib]:");
-    if (is_init_) {
-        vsag::logger::debug("   Init VsagLib success");
+// rows within radius of query, at most limit of them by ascending distance
+int HnswIndexHandler::range_search(const vsag::DatasetPtr& query, float radius, int64_t limit,
+                                   const std::string& parameters,
+                                   float* dist, int64_t* ids, int64_t &result_size,
+                                   float valid_ratio, FilterInterface *bitmap, bool reverse_filter,
+                                   bool need_extra_info, char* extra_infos) {
+    if (int check_ret = check_vectors(query); check_ret != 0) {
+        return check_ret;
+    }
+    OB_VSAG_LOG_DEBUG("  search_parameters:{}", parameters);
+    OB_VSAG_LOG_DEBUG("  radius:{}, limit:{}", radius, limit);
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    std::shared_lock<ObIndexLock> guard(index_lock_);
+    IndexSnapshotPtr snapshot = get_snapshot();
+    auto vsag_filter = make_search_filter(bitmap, reverse_filter, valid_ratio, *snapshot);
+    auto result = search_live_rows(*snapshot, limit, extra_info_size_, [&](int64_t fetch) {
+        auto rows = snapshot->index_->RangeSearch(query, radius, parameters, vsag_filter, fetch);
+        if (rows.has_value()) {
+            sort_search_result(rows.value(), extra_info_size_);
+        }
+        return rows;
+    });
+    if (result.has_value()) {
+        result_size = copy_search_result(result.value(), limit, dist, ids,
+                                         need_extra_info ? extra_infos : nullptr, extra_info_size_);
+        return 0;
     } else {
-        vsag::logger::debug("   Init VsagLib fail");
+        error = result.error().type;
     }
-    return is_init_; 
+    return static_cast<int>(error);
 }
 
-
-void set_logger(void *logger_ptr) {
-    vsag::Options::Instance().set_logger(static_cast<vsag::Logger*>(logger_ptr));
-    vsag::Logger::Level log_level = static_cast<vsag::Logger::Level>(1);//default is debug level
-    vsag::Options::Instance().logger()->SetLevel(log_level);
+int HnswIndexHandler::knn_search_batch(const float* query_vectors, int dim, int64_t query_count,
+                                       const int64_t* topks, const std::vector<const SearchPlan*>& plans,
+                                       float* dists, int64_t* ids, int64_t* result_sizes,
+                                       float valid_ratio, FilterInterface** bitmaps, int64_t filter_count,
+                                       bool reverse_filter, bool need_extra_info, char* extra_infos,
+                                       int thread_num) {
+    if (int check_ret = check_float_vectors(); check_ret != 0) {
+        return check_ret;
+    }
+    OB_VSAG_LOG_DEBUG("  query_count:{}, filter_count:{}, thread_num:{}", query_count, filter_count, thread_num);
+    std::vector<int64_t> offsets(query_count + 1, 0);
+    for (int64_t i = 0; i < query_count; ++i) {
+        offsets[i + 1] = offsets[i] + topks[i];
+    }
+    // all queries of the batch run against the same index
+    std::shared_lock<ObIndexLock> guard(index_lock_);
+    IndexSnapshotPtr snapshot = get_snapshot();
+    const TombstoneSnapshot& tombstones = snapshot->tombstones_;
+    // filter wrappers are created once and shared by the queries using the same filter,
+    // except for a shared filter with batch evaluation whose block cache is per search
+    std::vector<vsag::FilterPtr> vsag_filters(filter_count);
+    for (int64_t i = 0; i < filter_count; ++i) {
+        vsag_filters[i] = make_search_filter(bitmaps[i], reverse_filter, valid_ratio, *snapshot);
+    }
+    const bool share_filter = filter_count != 1
+        || bitmaps[0] == nullptr
+        || bitmaps[0]->get_filter_type() != CALLBACK_FILTER_TYPE
+        || bitmaps[0]->batch_size() <= 1;
+    std::atomic<int> first_error(0);
+    ObTaskScheduler::instance().parallel_for(tenant_id_, query_count, thread_num, [&](int64_t i) {
+        if (first_error.load(std::memory_order_relaxed) != 0) {
+            return;
+        }
+        auto query = vsag::Dataset::Make();
+        query->NumElements(1)->Dim(dim)->Float32Vectors(query_vectors + i * dim)->Owner(false);
+        vsag::FilterPtr vsag_filter = nullptr;
+        if (filter_count > 1) {
+            vsag_filter = vsag_filters[i];
+        } else if (filter_count == 1) {
+            vsag_filter = share_filter ? vsag_filters[0]
+                : make_search_filter(bitmaps[0], reverse_filter, valid_ratio, *snapshot);
+        } else if (tombstones != nullptr) {
+            vsag_filter = make_search_filter(nullptr, reverse_filter, valid_ratio, *snapshot);
+        }
+        auto result = search_live_rows(*snapshot, topks[i], extra_info_size_, [&](int64_t fetch) {
+            return snapshot->index_->KnnSearch(query, fetch, plans[i]->parameters_, vsag_filter);
+        });
+        if (result.has_value()) {
+            char* query_extra_infos = need_extra_info ? extra_infos + offsets[i] * extra_info_size_ : nullptr;
+            result_sizes[i] = copy_search_result(result.value(), topks[i],
+                                                 dists + offsets[i], ids + offsets[i],
+                                                 query_extra_infos, extra_info_size_);
+        } else {
+            int expected = 0;
+            first_error.compare_exchange_strong(expected, static_cast<int>(result.error().type));
+        }
+    });
+    return first_error.load();
 }
 
-void set_block_size_limit(uint64_t size) {
-    vsag::Options::Instance().set_block_size_limit(size);
-}
+// ids of the vid range checked together by the exact search of a handler
+static const int64_t EXACT_ID_CHUNK_SIZE = 4096;
 
-bool is_supported_index(IndexType index_type) {
-    return INVALID_INDEX_TYPE < index_type && index_type < MAX_INDEX_TYPE;
+// push the rows of ids not tombstoned into heaps[q] of every query, ids is reused as a buffer.
+// vsag reports the distance -1 for ids without a row, -1 is also a valid inner product, so
+// the ids scored -1 are looked up and skipped when the index has no row for them. Fails
+// without scoring once the index of snapshot was swapped out, see exact_search.
+int HnswIndexHandler::score_rows(const IndexSnapshot& snapshot, const float* query_vectors,
+                                 int64_t query_count, int64_t* ids, int64_t count, std::vector<ObTopkHeap>& heaps)
+{
+    const TombstoneSnapshot& tombstones = snapshot.tombstones_;
+    if (tombstones != nullptr) {
+        int64_t valid_count = 0;
+        for (int64_t i = 0; i < count; ++i) {
+            if (!roaring::api::roaring64_bitmap_contains(tombstones.get(), ids[i])) {
+                ids[valid_count++] = ids[i];
+            }
+        }
+        count = valid_count;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    std::shared_lock<ObIndexLock> guard(index_lock_);
+    if (get_index() != snapshot.index_) {
+        return static_cast<int>(vsag::ErrorType::INTERNAL_ERROR);
+    }
+    // row of ids[i] looked up: 1 exists, 0 missing, -1 not looked up yet
+    std::vector<int8_t> exists;
+    for (int64_t q = 0; q < query_count; ++q) {
+        auto result = snapshot.index_->CalDistanceById(query_vectors + q * dim_, ids, count);
+        if (!result.has_value()) {
+            return static_cast<int>(result.error().type);
+        }
+        const float* dists = result.value()->GetDistances();
+        for (int64_t i = 0; i < count; ++i) {
+            if (!heaps[q].accept(dists[i])) {
+                continue;
+            } else if (dists[i] == -1) {
+                if (exists.empty()) {
+                    exists.assign(count, -1);
+                }
+                if (exists[i] < 0) {
+                    exists[i] = snapshot.index_->CheckIdExist(ids[i]) ? 1 : 0;
+                }
+                if (exists[i] == 0) {
+                    continue;
+                }
+            }
+            heaps[q].push(dists[i], ids[i]);
+        }
+    }
+    return 0;
 }
 
-int create_index(VectorIndexPtr& index_handler, IndexType index_type,
-                 const char* dtype,
-                 const char* metric, int dim,
-                 int max_degree, int ef_construction, int ef_search, void* allocator,
-                 int extra_info_size/* = 0*/)
-{   
-    vsag::logger::debug("TRACE LOG[create_index]:");
-    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+// exact topk over the rows of the index, distances are computed by vsag on the vectors it keeps.
+// The rows are scored one chunk at a time under the search lock, a search that sees the index
+// swapped out between two chunks starts over on the new one.
+int HnswIndexHandler::exact_search(const float* query_vectors, int64_t query_count, int64_t topk,
+                                   FilterInterface* bitmap, bool reverse_filter, int thread_num,
+                                   float* dists, int64_t* ids, int64_t* result_sizes)
+{
+    if (int check_ret = check_float_vectors(); check_ret != 0) {
+        return check_ret;
+    }
     int ret = 0;
-    if (dtype == nullptr || metric == nullptr) {
-        vsag::logger::debug("   null pointer addr, dtype:{}, metric:{}", (void*)dtype, (void*)metric);
-        return static_cast<int>(vsag::ErrorType::UNKNOWN_ERROR);
+    IndexSnapshotPtr snapshot;
+    do {
+        snapshot = get_snapshot();
+        ret = exact_search(*snapshot, query_vectors, query_count, topk, bitmap, reverse_filter, thread_num,
+                           dists, ids, result_sizes);
+    } while (ret != 0 && get_index() != snapshot->index_);
+    return ret;
+}
+
+int HnswIndexHandler::exact_search(const IndexSnapshot& snapshot, const float* query_vectors, int64_t query_count,
+                                   int64_t topk, FilterInterface* bitmap, bool reverse_filter, int thread_num,
+                                   float* dists, int64_t* ids, int64_t* result_sizes)
+{
+    int64_t min_vid = 0;
+    int64_t max_vid = -1;
+    int ret = get_vid_bound(min_vid, max_vid);
+    if (ret != 0) {
+        return ret;
     }
-    // SlowTaskTimer t("z");
-    vsag::Allocator* vsag_allocator = NULL;
-    bool is_support = is_supported_index(index_type);
-    vsag::logger::debug("   index type : {}, is_supported : {}", static_cast<int>(index_type), is_support);
-    if (allocator == NULL) {
-        vsag_allocator = NULL;
-        vsag::logger::debug("   allocator is null ,use default_allocator");
-    } else {
-        vsag_allocator =  static_cast<vsag::Allocator*>(allocator);
-        vsag::logger::debug("   allocator_addr:{}",allocator);
+    const int64_t chunk_count = (max_vid - min_vid + EXACT_ID_CHUNK_SIZE) / EXACT_ID_CHUNK_SIZE;
+    const int64_t stripe_count = std::max<int64_t>(1, std::min<int64_t>(std::max(thread_num, 1), chunk_count));
+    std::vector<std::vector<ObTopkHeap>> heaps(stripe_count, std::vector<ObTopkHeap>(query_count, ObTopkHeap(topk)));
+    std::atomic<int> first_error(0);
+    ObTaskScheduler::instance().parallel_for(tenant_id_, stripe_count, thread_num, [&](int64_t stripe) {
+        std::vector<int64_t> chunk_ids(EXACT_ID_CHUNK_SIZE);
+        std::vector<uint8_t> filtered(EXACT_ID_CHUNK_SIZE);
+        for (int64_t chunk = chunk_count * stripe / stripe_count;
+             chunk < chunk_count * (stripe + 1) / stripe_count && first_error.load(std::memory_order_relaxed) == 0;
+             ++chunk) {
+            const int64_t begin = min_vid + chunk * EXACT_ID_CHUNK_SIZE;
+            const int64_t count = std::min(EXACT_ID_CHUNK_SIZE, max_vid - begin + 1);
+            for (int64_t i = 0; i < count; ++i) {
+                chunk_ids[i] = begin + i;
+            }
+            if (bitmap != nullptr) {
+                bitmap->test_batch(chunk_ids.data(), static_cast<int>(count), filtered.data());
+            }
+            int64_t valid_count = 0;
+            for (int64_t i = 0; i < count; ++i) {
+                if (bitmap == nullptr || static_cast<bool>(filtered[i]) == reverse_filter) {
+                    chunk_ids[valid_count++] = chunk_ids[i];
+                }
+            }
+            int chunk_ret = score_rows(snapshot, query_vectors, query_count, chunk_ids.data(), valid_count, heaps[stripe]);
+            if (chunk_ret != 0) {
+                int expected = 0;
+                first_error.compare_exchange_strong(expected, chunk_ret);
+                return;
+            }
+        }
+    });
+    if (first_error.load() != 0) {
+        return first_error.load();
     }
-    nlohmann::json index_parameters;
-    std::string index_type_str;
+    for (int64_t q = 0; q < query_count; ++q) {
+        for (int64_t stripe = 1; stripe < stripe_count; ++stripe) {
+            heaps[0][q].merge(heaps[stripe][q]);
+        }
+        result_sizes[q] = heaps[0][q].pop_sorted(dists + q * topk, ids + q * topk);
+    }
+    return 0;
+}
 
-    if (index_type == HNSW_TYPE) {
-        // create index
-        bool use_static = false;
-        index_type_str = "hnsw";
-        nlohmann::json hnsw_parameters{{"max_degree", max_degree},
-                                {"ef_construction", ef_construction},
-                                {"ef_search", ef_search},
-                                {"use_static", use_static}};
-        index_parameters = {{"dtype", dtype}, {"metric_type", metric}, {"dim", dim}, {"hnsw", hnsw_parameters}}; 
-    } else if (index_type == HNSW_SQ_TYPE) {
-        // create hnsw sq index
-        index_type_str = "hgraph";
-        max_degree *= 2;
-        nlohmann::json hnswsq_parameters{{"base_quantization_type", "sq8"},
-                                         // NOTE(liyao): max_degree compatible with behavior of HNSW, which is doubling the m value 
-                                         {"max_degree", max_degree}, 
-                                         {"ef_construction", ef_construction},
-                                         {"build_thread_count", 0}};
-        index_parameters = {{"dtype", dtype}, {"metric_type", metric}, {"dim", dim}, {"extra_info_size", extra_info_size}, {"index_param", hnswsq_parameters}}; 
-    } else if (index_type == HGRAPH_TYPE) {
-        // create hnsw fp index
-        index_type_str = "hgraph";
-        max_degree *= 2;
-        nlohmann::json hnswsq_parameters{{"base_quantization_type", "fp32"},
-                                         // NOTE(liyao): max_degree compatible with behavior of HNSW, which is doubling the m value 
-                                         {"max_degree", max_degree}, 
-                                         {"ef_construction", ef_construction},
-                                         {"build_thread_count", 0}};
-        index_parameters = {{"dtype", dtype}, {"metric_type", metric}, {"dim", dim}, {"extra_info_size", extra_info_size}, {"index_param", hnswsq_parameters}}; 
-    } else if (index_type == HNSW_BQ_TYPE) {
-        // create hnsw bq index
-        index_type_str = "hgraph";
-        max_degree *= 2;
-        nlohmann::json hnswsq_parameters{{"base_quantization_type", "rabitq"},
-                                         // NOTE(liyao): max_degree compatible with behavior of HNSW, which is doubling the m value 
-                                         {"max_degree", max_degree}, 
-                                         {"ef_construction", ef_construction},
-                                         {"build_thread_count", 0},
-                                         {"use_reorder", true},
-                                         {"ignore_reorder", true},
-                                         {"precise_quantization_type", "fp32"},
-                                         {"precise_io_type", "block_memory_io"}}; 
-        index_parameters = {{"dtype", dtype}, {"metric_type", metric}, {"dim", dim}, {"extra_info_size", extra_info_size}, {"index_param", hnswsq_parameters}}; 
-    } else if (!is_support) {
-        error = vsag::ErrorType::UNSUPPORTED_INDEX;
-        vsag::logger::debug("   fail to create hnsw index , index type not supported:{}", static_cast<int>(index_type));
-        return static_cast<int>(error);
+static std::atomic<int64_t> exact_scan_max_rows(DEFAULT_EXACT_SCAN_MAX_ROWS);
+static std::atomic<float> exact_scan_ratio(DEFAULT_EXACT_SCAN_RATIO);
+
+// ids tested to estimate the selectivity of a filter without valid_ratio
+static const int64_t FILTER_SAMPLE_SIZE = 256;
+
+/*
+ * Choose how one filtered query runs. The rows kept by the filter are counted for a roaring
+ * filter, estimated from valid_ratio when it is >= 0, or from FILTER_SAMPLE_SIZE random ids
+ * of the vid range otherwise. Few kept rows are scored one by one by exact_scan, graph search
+ * would visit most of the index to find them; otherwise hnsw skips fewer filtered out
+ * neighbors as the filter gets more selective, to keep the graph connected.
+ */
+FilterPlan HnswIndexHandler::plan_filter(FilterInterface* bitmap, bool reverse_filter, float valid_ratio,
+                                         bool use_extra_info_filter)
+{
+    FilterPlan plan;
+    plan.exact_scan_ = false;
+    plan.valid_ratio_ = valid_ratio < 0 ? 1.0f : valid_ratio;
+    plan.skip_ratio_ = DEFAULT_SKIP_RATIO;
+    if (bitmap == nullptr || use_extra_info_filter) {
+        return plan;
+    }
+    int64_t element_count = get_index()->GetNumElements();
+    if (element_count == 0) {
+        return plan;
+    }
+    const roaring::api::roaring64_bitmap_t* roaring = get_roaring_bitmap(bitmap);
+    int64_t min_vid = 0;
+    int64_t max_vid = -1;
+    if ((roaring != nullptr || valid_ratio < 0) && (get_vid_bound(min_vid, max_vid) != 0 || max_vid < min_vid)) {
+        return plan;
     }
+    if (roaring != nullptr) {
+        // ids of the bitmap out of the vid range have no row
+        int64_t cardinality = static_cast<int64_t>(
+            roaring::api::roaring64_bitmap_range_cardinality(roaring, min_vid, static_cast<uint64_t>(max_vid) + 1));
+        int64_t kept = reverse_filter ? cardinality : element_count - cardinality;
+        plan.valid_ratio_ = static_cast<float>(kept) / element_count;
+    } else if (valid_ratio < 0) {
+        static thread_local std::mt19937_64 rng(std::random_device{}());
+        std::uniform_int_distribution<int64_t> distrib(min_vid, max_vid);
+        int64_t sample_ids[FILTER_SAMPLE_SIZE];
+        uint8_t filtered[FILTER_SAMPLE_SIZE];
+        for (int64_t i = 0; i < FILTER_SAMPLE_SIZE; ++i) {
+            sample_ids[i] = distrib(rng);
+        }
+        bitmap->test_batch(sample_ids, FILTER_SAMPLE_SIZE, filtered);
+        int64_t kept = 0;
+        for (int64_t i = 0; i < FILTER_SAMPLE_SIZE; ++i) {
+            kept += static_cast<bool>(filtered[i]) == reverse_filter;
+        }
+        plan.valid_ratio_ = static_cast<float>(kept) / FILTER_SAMPLE_SIZE;
+    }
+    plan.valid_ratio_ = std::min(std::max(plan.valid_ratio_, 0.0f), 1.0f);
+    plan.exact_scan_ = plan.valid_ratio_ * element_count <= exact_scan_max_rows.load(std::memory_order_relaxed)
+                       || plan.valid_ratio_ <= exact_scan_ratio.load(std::memory_order_relaxed);
+    if (HNSW_TYPE == index_type_) {
+        // one decimal, so that few search plans are cached
+        plan.skip_ratio_ = std::round(std::min(DEFAULT_SKIP_RATIO, plan.valid_ratio_) * 10) / 10;
+    }
+    OB_VSAG_LOG_DEBUG("   filter plan, exact_scan:{}, valid_ratio:{}, skip_ratio:{}",
+                      plan.exact_scan_, plan.valid_ratio_, plan.skip_ratio_);
+    return plan;
+}
 
-    if (auto index = vsag::Factory::CreateIndex(index_type_str, index_parameters.dump(), vsag_allocator);
-        index.has_value()) {
-        std::shared_ptr<vsag::Index> hnsw;
+// visit(id) the ids of [min_vid, max_vid] kept by a roaring filter in ascending order, until it returns false
+template <typename Visit>
+static void for_each_kept_id(const roaring::api::roaring64_bitmap_t* roaring, bool reverse_filter,
+                             int64_t min_vid, int64_t max_vid, Visit visit)
+{
+    // the ids left out by the filter are the vid range minus the bitmap
+    roaring::api::roaring64_bitmap_t* kept = nullptr;
+    if (!reverse_filter) {
+        kept = roaring::api::roaring64_bitmap_from_range(min_vid, max_vid + 1, 1);
+        roaring::api::roaring64_bitmap_andnot_inplace(kept, roaring);
+    }
+    roaring::api::roaring64_iterator_t* iter = roaring::api::roaring64_iterator_create(kept != nullptr ? kept : roaring);
+    for (bool has_value = roaring::api::roaring64_iterator_move_equalorlarger(iter, min_vid);
+         has_value && static_cast<int64_t>(roaring::api::roaring64_iterator_value(iter)) <= max_vid
+         && visit(static_cast<int64_t>(roaring::api::roaring64_iterator_value(iter)));
+         has_value = roaring::api::roaring64_iterator_advance(iter)) {
+    }
+    roaring::api::roaring64_iterator_free(iter);
+    if (kept != nullptr) {
+        roaring::api::roaring64_bitmap_free(kept);
+    }
+}
+
+// same for a bitset filter, the kept ids of its range are found a word at a time
+template <typename Visit>
+static void for_each_kept_id(const BitsetFilter& bitset, bool reverse_filter,
+                             int64_t min_vid, int64_t max_vid, Visit visit)
+{
+    const int64_t first = std::max(min_vid, bitset.get_min_vid());
+    const int64_t last = std::min(max_vid, bitset.get_max_vid());
+    // ids out of the bitset are never filtered out
+    for (int64_t id = min_vid; !reverse_filter && id <= max_vid && id < first; ++id) {
+        if (!visit(id)) {
+            return;
+        }
+    }
+    const uint64_t* words = bitset.get_words();
+    const int64_t last_offset = last - bitset.get_min_vid();
+    for (int64_t offset = first - bitset.get_min_vid(); offset <= last_offset; offset = (offset | 63) + 1) {
+        uint64_t word = reverse_filter ? words[offset >> 6] : ~words[offset >> 6];
+        word &= ~0ULL << (offset & 63);
+        if ((offset | 63) > last_offset) {
+            word &= ~0ULL >> ((offset | 63) - last_offset);
+        }
+        for (; word != 0; word &= word - 1) {
+            if (!visit(bitset.get_min_vid() + (offset & ~63LL) + __builtin_ctzll(word))) {
+                return;
+            }
+        }
+    }
+    for (int64_t id = std::max(min_vid, last + 1); !reverse_filter && id <= max_vid; ++id) {
+        if (!visit(id)) {
+            return;
+        }
+    }
+}
+
+// exact topk of one query over the rows kept by bitmap, the ids kept by a roaring or bitset
+// filter are enumerated, opaque filters are tested over the vid range
+int HnswIndexHandler::exact_scan(const float* query_vector, int64_t topk, FilterInterface* bitmap,
+                                 bool reverse_filter, float* dist, int64_t* ids, int64_t& result_size,
+                                 char* extra_infos)
+{
+    if (int check_ret = check_float_vectors(); check_ret != 0) {
+        return check_ret;
+    }
+    int ret = 0;
+    IndexSnapshotPtr snapshot;
+    do {
+        snapshot = get_snapshot();
+        ret = exact_scan(*snapshot, query_vector, topk, bitmap, reverse_filter, dist, ids, result_size, extra_infos);
+    } while (ret != 0 && get_index() != snapshot->index_);
+    return ret;
+}
+
+int HnswIndexHandler::exact_scan(const IndexSnapshot& snapshot, const float* query_vector, int64_t topk,
+                                 FilterInterface* bitmap, bool reverse_filter, float* dist, int64_t* ids,
+                                 int64_t& result_size, char* extra_infos)
+{
+    int ret = 0;
+    const roaring::api::roaring64_bitmap_t* roaring = get_roaring_bitmap(bitmap);
+    const BitsetFilter* bitset = get_bitset_filter(bitmap);
+    if (roaring != nullptr || bitset != nullptr) {
+        int64_t min_vid = 0;
+        int64_t max_vid = -1;
+        ret = get_vid_bound(min_vid, max_vid);
+        std::vector<ObTopkHeap> heaps(1, ObTopkHeap(topk));
+        std::vector<int64_t> chunk_ids;
+        chunk_ids.reserve(EXACT_ID_CHUNK_SIZE);
+        auto visit = [&](int64_t id) {
+            chunk_ids.push_back(id);
+            if (static_cast<int64_t>(chunk_ids.size()) == EXACT_ID_CHUNK_SIZE) {
+                ret = score_rows(snapshot, query_vector, 1, chunk_ids.data(), chunk_ids.size(), heaps);
+                chunk_ids.clear();
+            }
+            return ret == 0;
+        };
+        if (ret == 0 && max_vid >= min_vid && roaring != nullptr) {
+            for_each_kept_id(roaring, reverse_filter, min_vid, max_vid, visit);
+        } else if (ret == 0 && max_vid >= min_vid) {
+            for_each_kept_id(*bitset, reverse_filter, min_vid, max_vid, visit);
+        }
+        if (ret == 0 && !chunk_ids.empty()) {
+            ret = score_rows(snapshot, query_vector, 1, chunk_ids.data(), chunk_ids.size(), heaps);
+        }
+        if (ret == 0) {
+            result_size = heaps[0].pop_sorted(dist, ids);
+        }
+    } else {
+        ret = exact_search(snapshot, query_vector, 1, topk, bitmap, reverse_filter, 1, dist, ids, &result_size);
+    }
+    if (ret == 0 && extra_infos != nullptr && result_size > 0) {
+        std::shared_lock<ObIndexLock> guard(index_lock_);
+        if (get_index() != snapshot.index_) {
+            return static_cast<int>(vsag::ErrorType::INTERNAL_ERROR);
+        }
+        snapshot.index_->GetExtraInfoByIds(ids, result_size, extra_infos);
+    }
+    return ret;
+}
+
+// exact_scan into buffers allocated like the results of vsag: from the allocator of the
+// index, or with malloc as the default allocator of vsag when create_index was given none
+int HnswIndexHandler::exact_scan(const float* query_vector, int64_t topk, FilterInterface* bitmap,
+                                 bool reverse_filter, const float*& dist, const int64_t*& ids,
+                                 int64_t& result_size, bool need_extra_info, const char*& extra_infos)
+{
+    auto allocate = [this](int64_t size) {
+        return allocator_ != nullptr ? allocator_->Allocate(size) : malloc(size);
+    };
+    auto release = [this](void* p) {
+        if (allocator_ == nullptr) {
+            free(p);
+        } else if (p != nullptr) {
+            allocator_->Deallocate(p);
+        }
+    };
+    float* result_dist = static_cast<float*>(allocate(std::max<int64_t>(topk, 1) * sizeof(float)));
+    int64_t* result_ids = static_cast<int64_t*>(allocate(std::max<int64_t>(topk, 1) * sizeof(int64_t)));
+    char* result_extra_infos = need_extra_info && extra_info_size_ > 0
+        ? static_cast<char*>(allocate(std::max<int64_t>(topk, 1) * extra_info_size_)) : nullptr;
+    int ret = 0;
+    if (result_dist == nullptr || result_ids == nullptr || (need_extra_info && extra_info_size_ > 0 && result_extra_infos == nullptr)) {
+        ret = static_cast<int>(vsag::ErrorType::NO_ENOUGH_MEMORY);
+    } else {
+        ret = exact_scan(query_vector, topk, bitmap, reverse_filter, result_dist, result_ids, result_size,
+                         result_extra_infos);
+    }
+    if (ret != 0) {
+        release(result_dist);
+        release(result_ids);
+        release(result_extra_infos);
+        return ret;
+    }
+    dist = result_dist;
+    ids = result_ids;
+    if (need_extra_info) {
+        extra_infos = result_extra_infos;
+    }
+    return 0;
+}
+
+// hit_count rows of the exact topk of the queries are returned by knn search, out of expected_count
+int HnswIndexHandler::evaluate_recall(const float* query_vectors, int64_t query_count, int64_t topk, int ef_search,
+                                      FilterInterface* bitmap, bool reverse_filter, int thread_num,
+                                      int64_t& hit_count, int64_t& expected_count)
+{
+    std::vector<int64_t> topks(query_count, topk);
+    std::vector<const SearchPlan*> plans(query_count, get_search_plan(ef_search, false));
+    std::vector<float> dists(query_count * topk);
+    std::vector<int64_t> knn_ids(query_count * topk);
+    std::vector<int64_t> knn_sizes(query_count);
+    std::vector<int64_t> exact_ids(query_count * topk);
+    std::vector<int64_t> exact_sizes(query_count);
+    int ret = knn_search_batch(query_vectors, dim_, query_count, topks.data(), plans,
+                               dists.data(), knn_ids.data(), knn_sizes.data(), 1.0,
+                               &bitmap, bitmap == nullptr ? 0 : 1, reverse_filter, false, nullptr, thread_num);
+    if (ret == 0) {
+        ret = exact_search(query_vectors, query_count, topk, bitmap, reverse_filter, thread_num,
+                           dists.data(), exact_ids.data(), exact_sizes.data());
+    }
+    if (ret != 0) {
+        return ret;
+    }
+    hit_count = 0;
+    expected_count = 0;
+    for (int64_t q = 0; q < query_count; ++q) {
+        std::unordered_set<int64_t> expected(exact_ids.begin() + q * topk, exact_ids.begin() + q * topk + exact_sizes[q]);
+        for (int64_t i = 0; i < knn_sizes[q]; ++i) {
+            hit_count += expected.count(knn_ids[q * topk + i]);
+        }
+        expected_count += exact_sizes[q];
+    }
+    return 0;
+}
+
+void HnswIndexHandler::set_recall_monitor(int64_t sample_interval, float min_recall)
+{
+    min_recall_.store(min_recall);
+    recall_sample_interval_.store(sample_interval);
+}
+
+// check one of every sample_interval unfiltered searches against the exact search in background,
+// a search sampled while the previous check is running is not checked
+void HnswIndexHandler::sample_recall(const float* query_vector, int64_t topk, const int64_t* ids, int64_t result_size)
+{
+    int64_t sample_interval = recall_sample_interval_.load(std::memory_order_relaxed);
+    if (sample_interval <= 0 || topk <= 0
+        || recall_query_seq_.fetch_add(1, std::memory_order_relaxed) % sample_interval != 0) {
+        return;
+    } else if (get_scan_size() > recall_check_budget.load(std::memory_order_relaxed)) {
+        // the exact search scans every id of the vid range, too many to check one query
+        OB_VSAG_LOG_DEBUG("   skip recall check, scan_size:{}", get_scan_size());
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(recall_mutex_);
+        if (recall_running_) {
+            return;
+        }
+        recall_running_ = true;
+    }
+    std::vector<float> query(query_vector, query_vector + dim_);
+    std::vector<int64_t> knn_ids(ids, ids + result_size);
+    auto finish = [this]() {
+        std::lock_guard<std::mutex> lock(recall_mutex_);
+        recall_running_ = false;
+        recall_cond_.notify_all();
+    };
+    ObTaskScheduler::instance().submit(get_tenant_id(), [this, query, knn_ids, topk, finish]() {
+        std::vector<float> dists(topk);
+        std::vector<int64_t> exact_ids(topk);
+        int64_t exact_size = 0;
+        int ret = exact_search(query.data(), 1, topk, nullptr, false, 1, dists.data(), exact_ids.data(), &exact_size);
+        if (ret == 0 && exact_size > 0) {
+            std::unordered_set<int64_t> expected(exact_ids.begin(), exact_ids.begin() + exact_size);
+            int64_t hit_count = 0;
+            for (int64_t id : knn_ids) {
+                hit_count += expected.count(id);
+            }
+            stats_.record_recall(hit_count, exact_size);
+            if (hit_count < min_recall_.load() * exact_size) {
+                vsag::logger::warn("   recall check below {}, hit:{}, expected:{}, index_type:{}, element_count:{}",
+                                   min_recall_.load(), hit_count, exact_size, static_cast<int>(index_type_), get_index_number());
+            }
+        } else if (ret != 0) {
+            vsag::logger::warn("   recall check fail, ret={}", ret);
+        }
+        finish();
+    }, finish);
+}
+
+void HnswIndexHandler::wait_recall_check()
+{
+    std::unique_lock<std::mutex> lock(recall_mutex_);
+    recall_cond_.wait(lock, [this]() { return !recall_running_; });
+}
+
+// ef_search values tried by a calibration, by increasing cost
+static const int CALIBRATION_EF_SEARCHES[] = {16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024};
+// at most this many topk values are tuned, further ones use the tuned ef_search of a larger topk
+static const size_t MAX_TUNED_TOPK_NUM = 8;
+
+void HnswIndexHandler::set_recall_target(float target_recall)
+{
+    recall_target_.store(target_recall);
+    if (target_recall > 0) {
+        schedule_calibration();
+    } else {
+        std::atomic_store(&tuned_ef_searches_, std::shared_ptr<const std::map<int64_t, int>>());
+    }
+}
+
+// ef_search <= 0 asks for the tuned ef_search of topk, or the ef_search of create_index until
+// the first calibration is done
+int HnswIndexHandler::resolve_ef_search(int ef_search, int64_t topk)
+{
+    if (ef_search > 0) {
+        return ef_search;
+    } else if (recall_target_.load(std::memory_order_relaxed) <= 0) {
+        return ef_search_;
+    }
+    std::shared_ptr<const std::map<int64_t, int>> tuned = std::atomic_load(&tuned_ef_searches_);
+    if (tuned != nullptr) {
+        auto iter = tuned->find(topk);
+        if (iter != tuned->end()) {
+            return iter->second;
+        }
+    }
+    bool inserted = false;
+    {
+        std::lock_guard<std::mutex> lock(calibration_mutex_);
+        if (tuned_topks_.size() < MAX_TUNED_TOPK_NUM) {
+            inserted = tuned_topks_.insert(topk).second;
+        }
+    }
+    if (inserted) {
+        schedule_calibration();
+    }
+    if (tuned != nullptr && !tuned->empty()) {
+        auto iter = tuned->lower_bound(topk);
+        return iter != tuned->end() ? iter->second : std::max<int>(tuned->rbegin()->second, topk);
+    }
+    return ef_search_;
+}
+
+void HnswIndexHandler::sample_query(const float* query_vector)
+{
+    if (recall_target_.load(std::memory_order_relaxed) > 0) {
+        query_sampler_.offer(query_vector, 1, dim_);
+    }
+}
+
+// called after rows are written, a calibration starts once the index grew by a tenth
+void HnswIndexHandler::sample_rows(const float* vectors, int64_t count)
+{
+    row_sampler_.offer(vectors, count, dim_);
+    if (recall_target_.load(std::memory_order_relaxed) > 0) {
+        int64_t calibrated_rows = calibrated_rows_.load();
+        if (get_index_number() - calibrated_rows >= std::max<int64_t>(calibrated_rows / 10, CALIBRATION_QUERY_NUM)) {
+            schedule_calibration();
+        }
+    }
+}
+
+void HnswIndexHandler::schedule_calibration()
+{
+    {
+        std::lock_guard<std::mutex> lock(calibration_mutex_);
+        if (calibration_running_) {
+            calibration_pending_ = true;
+            return;
+        }
+        calibration_running_ = true;
+    }
+    ObTaskScheduler::instance().submit(get_tenant_id(), [this]() { calibrate_ef_search(); }, [this]() {
+        std::lock_guard<std::mutex> lock(calibration_mutex_);
+        calibration_running_ = false;
+        calibration_pending_ = false;
+        calibration_cond_.notify_all();
+    });
+}
+
+void HnswIndexHandler::wait_calibration()
+{
+    std::unique_lock<std::mutex> lock(calibration_mutex_);
+    calibration_cond_.wait(lock, [this]() { return !calibration_running_; });
+}
+
+/*
+ * Measure recall@topk of sampled queries for increasing ef_search against the exact search
+ * and keep the smallest ef_search meeting the recall target for every tuned topk. Live
+ * queries are sampled once the target is set, rows written to the index are used until
+ * enough queries are seen.
+ */
+void HnswIndexHandler::calibrate_ef_search()
+{
+    while (true) {
+        float target = recall_target_.load();
+        std::vector<float> queries;
+        int64_t query_count = query_sampler_.get(queries, dim_);
+        if (query_count < CALIBRATION_QUERY_NUM / 4) {
+            query_count = row_sampler_.get(queries, dim_);
+        }
+        std::vector<int64_t> topks;
+        {
+            std::lock_guard<std::mutex> lock(calibration_mutex_);
+            topks.assign(tuned_topks_.begin(), tuned_topks_.end());
+        }
+        // values measured on an index swapped out meanwhile are dropped, the swap moved the old ones in
+        std::shared_ptr<vsag::Index> index = get_index();
+        int64_t element_count = index->GetNumElements();
+        // the exact search scans every id of the vid range once per query, keep as many queries as the budget allows
+        const int64_t scan_size = get_scan_size();
+        const int64_t max_query_count = recall_check_budget.load() / std::max<int64_t>(scan_size, 1);
+        if (target > 0 && query_count > 0 && element_count > 0 && max_query_count == 0) {
+            vsag::logger::info("   skip calibrate ef_search, element_count:{}, scan_size:{}, budget:{}",
+                               element_count, scan_size, recall_check_budget.load());
+            std::lock_guard<std::mutex> lock(snapshot_mutex_);
+            if (get_index() == index) {
+                calibrated_rows_.store(element_count);
+            }
+        }
+        query_count = std::min(query_count, max_query_count);
+        if (target > 0 && query_count > 0 && element_count > 0) {
+            const int64_t max_topk = topks.back();
+            std::vector<float> dists(query_count * max_topk);
+            std::vector<int64_t> exact_ids(query_count * max_topk);
+            std::vector<int64_t> exact_sizes(query_count);
+            std::vector<int64_t> knn_ids(query_count * max_topk);
+            std::vector<int64_t> knn_sizes(query_count);
+            std::vector<int64_t> query_topks(query_count, max_topk);
+            int ret = exact_search(queries.data(), query_count, max_topk, nullptr, false, 1,
+                                   dists.data(), exact_ids.data(), exact_sizes.data());
+            auto tuned = std::make_shared<std::map<int64_t, int>>();
+            for (size_t e = 0; ret == 0 && e < sizeof(CALIBRATION_EF_SEARCHES) / sizeof(int)
+                               && tuned->size() < topks.size(); ++e) {
+                const int ef_search = CALIBRATION_EF_SEARCHES[e];
+                std::vector<const SearchPlan*> plans(query_count, get_search_plan(ef_search, false));
+                ret = knn_search_batch(queries.data(), dim_, query_count, query_topks.data(), plans,
+                                       dists.data(), knn_ids.data(), knn_sizes.data(), 1.0,
+                                       nullptr, 0, false, false, nullptr, 1);
+                for (int64_t topk : topks) {
+                    if (ret != 0 || ef_search < topk || tuned->count(topk) > 0) {
+                        continue;
+                    }
+                    int64_t hit_count = 0;
+                    int64_t expected_count = 0;
+                    for (int64_t q = 0; q < query_count; ++q) {
+                        int64_t exact_size = std::min(topk, exact_sizes[q]);
+                        std::unordered_set<int64_t> expected(exact_ids.begin() + q * max_topk,
+                                                             exact_ids.begin() + q * max_topk + exact_size);
+                        for (int64_t i = 0; i < std::min(topk, knn_sizes[q]); ++i) {
+                            hit_count += expected.count(knn_ids[q * max_topk + i]);
+                        }
+                        expected_count += exact_size;
+                    }
+                    if (hit_count >= target * expected_count) {
+                        (*tuned)[topk] = ef_search;
+                        vsag::logger::info("   tuned ef_search:{}, topk:{}, recall:{}, target:{}, element_count:{}",
+                                           ef_search, topk, expected_count == 0 ? 1.0 : static_cast<double>(hit_count) / expected_count,
+                                           target, element_count);
+                    }
+                }
+            }
+            if (ret == 0) {
+                const int max_ef_search = CALIBRATION_EF_SEARCHES[sizeof(CALIBRATION_EF_SEARCHES) / sizeof(int) - 1];
+                for (int64_t topk : topks) {
+                    if (tuned->count(topk) == 0) {
+                        vsag::logger::warn("   recall target {} not met by ef_search {}, topk:{}", target, max_ef_search, topk);
+                        (*tuned)[topk] = std::max<int>(max_ef_search, topk);
+                    }
+                }
+                std::lock_guard<std::mutex> lock(snapshot_mutex_);
+                if (get_index() == index) {
+                    std::atomic_store(&tuned_ef_searches_, std::shared_ptr<const std::map<int64_t, int>>(tuned));
+                    calibrated_rows_.store(element_count);
+                }
+            } else {
+                vsag::logger::warn("   calibrate ef_search fail, ret={}", ret);
+            }
+        }
+        std::lock_guard<std::mutex> lock(calibration_mutex_);
+        if (calibration_pending_) {
+            calibration_pending_ = false;
+            continue;
+        }
+        calibration_running_ = false;
+        calibration_cond_.notify_all();
+        return;
+    }
+}
+
+bool is_init_ = vsag::init();
+
+void
+set_log_level(int32_t ob_level_num) {
+    std::map<int32_t, int32_t> ob2vsag_log_level = {
+        {0 /*ERROR*/, vsag::Logger::Level::kERR},
+        {1 /*WARN*/, vsag::Logger::Level::kWARN},
+        {2 /*INFO*/, vsag::Logger::Level::kINFO},
+        {3 /*EDIAG*/, vsag::Logger::Level::kERR},
+        {4 /*WDIAG*/, vsag::Logger::Level::kWARN},
+        {5 /*TRACE*/, vsag::Logger::Level::kTRACE},
+        {6 /*DEBUG*/, vsag::Logger::Level::kDEBUG},
+    };
+    vsag::logger::set_level(static_cast<vsag::logger::level>(ob2vsag_log_level[ob_level_num]));
+}
+
+bool is_init() {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[Init VsagLib]:");
+    if (is_init_) {
+        OB_VSAG_LOG_DEBUG("   Init VsagLib success");
+    } else {
+        OB_VSAG_LOG_DEBUG("   Init VsagLib fail");
+    }
+    return is_init_; 
+}
+
+
+void set_logger(void *logger_ptr) {
+    vsag::Options::Instance().set_logger(static_cast<vsag::Logger*>(logger_ptr));
+    // the level is the one of set_log_level, the new logger is set to it as well
+    vsag::logger::set_level(vsag::logger::get_level());
+}
+
+int set_slow_log(IndexOpType op, int64_t threshold_us, int64_t sample_interval) {
+    if (op < 0 || op >= MAX_OP || sample_interval <= 0) {
+        vsag::logger::error("   invalid slow log setting, op:{}, sample_interval:{}", static_cast<int>(op), sample_interval);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    }
+    slow_log_configs[op].sample_interval_.store(sample_interval);
+    slow_log_configs[op].threshold_us_.store(threshold_us);
+    vsag::logger::info("   set slow log of {}, threshold_us:{}, sample_interval:{}", OP_NAMES[op], threshold_us, sample_interval);
+    return 0;
+}
+
+void set_block_size_limit(uint64_t size) {
+    vsag::Options::Instance().set_block_size_limit(size);
+}
+
+void set_thread_pool(TaskExecutor* executor) {
+    ObTaskScheduler::instance().set_executor(executor);
+}
+
+void set_max_threads(int thread_num) {
+    ObTaskScheduler::instance().set_max_threads(thread_num);
+}
+
+void set_tenant_thread_quota(int64_t tenant_id, int max_threads) {
+    ObTaskScheduler::instance().set_tenant_quota(tenant_id, max_threads);
+}
+
+int set_index_tenant(VectorIndexPtr& index_handler, int64_t tenant_id) {
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    if (index_handler == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
+        return static_cast<int>(error);
+    }
+    static_cast<HnswIndexHandler*>(index_handler)->set_tenant_id(tenant_id);
+    return 0;
+}
+
+int set_precise_vector_file(VectorIndexPtr& index_handler, const char* file_path) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[set_precise_vector_file]:");
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    if (index_handler == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
+        return static_cast<int>(error);
+    }
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    if (hnsw->get_index_type() != HNSW_BQ_TYPE) {
+        vsag::logger::error("   precise vector file is only supported by HNSW_BQ_TYPE, index_type:{}", hnsw->get_index_type());
+        return static_cast<int>(vsag::ErrorType::UNSUPPORTED_INDEX_OPERATION);
+    }
+    hnsw->set_precise_file_path(file_path == nullptr ? std::string() : std::string(file_path));
+    OB_VSAG_LOG_DEBUG("   precise vector file:{}", hnsw->get_precise_file_path());
+    return 0;
+}
+
+bool is_supported_index(IndexType index_type) {
+    return INVALID_INDEX_TYPE < index_type && index_type < MAX_INDEX_TYPE;
+}
+
+int create_index(VectorIndexPtr& index_handler, IndexType index_type,
+                 const char* dtype,
+                 const char* metric, int dim,
+                 int max_degree, int ef_construction, int ef_search, void* allocator,
+                 int extra_info_size/* = 0*/, int build_thread_count/* = 0*/)
+{   
+    OB_VSAG_LOG_DEBUG("TRACE LOG[create_index]:");
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    int ret = 0;
+    if (dtype == nullptr || metric == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, dtype:{}, metric:{}", (void*)dtype, (void*)metric);
+        return static_cast<int>(vsag::ErrorType::UNKNOWN_ERROR);
+    } else if (!is_supported_dtype(index_type, dtype)) {
+        vsag::logger::error("   dtype {} not supported by index type {}", dtype, static_cast<int>(index_type));
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    }
+    vsag::Allocator* vsag_allocator = NULL;
+    bool is_support = is_supported_index(index_type);
+    OB_VSAG_LOG_DEBUG("   index type : {}, is_supported : {}", static_cast<int>(index_type), is_support);
+    if (allocator == NULL) {
+        vsag_allocator = NULL;
+        OB_VSAG_LOG_DEBUG("   allocator is null ,use default_allocator");
+    } else {
+        vsag_allocator =  static_cast<vsag::Allocator*>(allocator);
+        OB_VSAG_LOG_DEBUG("   allocator_addr:{}",allocator);
+    }
+    nlohmann::json index_parameters;
+    std::string index_type_str;
+
+    if (index_type == HNSW_TYPE || index_type == HNSW_SQ_TYPE
+        || index_type == HGRAPH_TYPE || index_type == HNSW_BQ_TYPE) {
+        if (index_type != HNSW_TYPE) {
+            // NOTE(liyao): max_degree compatible with behavior of HNSW, which is doubling the m value 
+            max_degree *= 2;
+        }
+        index_type_str = get_index_type_str(index_type);
+        index_parameters = make_index_parameters(index_type, dtype, metric, dim, max_degree, ef_construction,
+                                                 ef_search, false/*use_static*/, extra_info_size, build_thread_count,
+                                                 ObTaskScheduler::DEFAULT_TENANT_ID);
+    } else if (!is_support) {
+        error = vsag::ErrorType::UNSUPPORTED_INDEX;
+        OB_VSAG_LOG_DEBUG("   fail to create hnsw index , index type not supported:{}", static_cast<int>(index_type));
+        return static_cast<int>(error);
+    }
+
+    if (auto index = vsag::Factory::CreateIndex(index_type_str, index_parameters.dump(), vsag_allocator);
+        index.has_value()) {
+        std::shared_ptr<vsag::Index> hnsw;
         hnsw = index.value();
         HnswIndexHandler* hnsw_index = new HnswIndexHandler(true,
                                                             false,
@@ -452,229 +2508,1334 @@ int create_index(VectorIndexPtr& index_handler, IndexType index_type,
                                                             index_type,
                                                             hnsw,
                                                             vsag_allocator,
-                                                            extra_info_size);
+                                                            extra_info_size,
+                                                            build_thread_count);
         index_handler = static_cast<VectorIndexPtr>(hnsw_index);
-        vsag::logger::debug("   success to create hnsw index , index parameter:{}, allocator addr:{}",index_parameters.dump(), (void*)vsag_allocator);
+        OB_VSAG_LOG_DEBUG("   success to create hnsw index , index parameter:{}, allocator addr:{}",index_parameters.dump(), (void*)vsag_allocator);
         return 0;
     } else {
         error = index.error().type;
-        vsag::logger::debug("   fail to create hnsw index , index parameter:{}", index_parameters.dump());
+        OB_VSAG_LOG_DEBUG("   fail to create hnsw index , index parameter:{}", index_parameters.dump());
+    }
+    ret = static_cast<int>(error);
+    if (ret != 0) {
+        vsag::logger::error("   create index error happend, ret={}", static_cast<int>(error));
+    }
+    return ret;
+}
+
+// rows written by one build_index/add_index after the ingest stage, see set_ingest_options
+struct ObIngestBatch {
+    std::vector<float> vectors_;
+    std::vector<uint8_t> rejected_;
+    std::vector<int64_t> ids_;       // ids of the kept rows, only filled when rows are dropped
+    std::vector<char> extra_infos_;  // same for the extra infos
+    int64_t* kept_ids_ = nullptr;
+    char* kept_extra_infos_ = nullptr;
+    int64_t kept_count_ = 0;
+};
+
+// rows of the typed add_index and of the ingest stage converted to fp32 at a time
+static const int64_t TYPED_ADD_BLOCK_ROWS = 4096;
+
+// convert and check count rows of src into batch, the kept rows are moved to the front of vectors_
+static int64_t ingest_batch(HnswIndexHandler* hnsw, const void* src, VectorDataType vector_type,
+                            int64_t* ids, char* extra_infos, int64_t count, int dim, int flags, int thread_num,
+                            ObIngestBatch& batch)
+{
+    batch.vectors_.resize(count * dim);
+    batch.rejected_.resize(count);
+    const int64_t rejected = ingest_rows_to_float(vector_type, src, count, dim, flags, hnsw->get_tenant_id(),
+                                                  thread_num, batch.vectors_.data(), batch.rejected_.data());
+    batch.kept_ids_ = ids;
+    batch.kept_extra_infos_ = extra_infos;
+    batch.kept_count_ = count;
+    if (rejected > 0) {
+        // the caller buffers are left as they are, kept ids and extra infos are copied
+        const uint64_t extra_info_size = hnsw->get_extra_info_size();
+        int64_t kept = 0;
+        batch.ids_.clear();
+        batch.extra_infos_.clear();
+        for (int64_t i = 0; i < count; ++i) {
+            if (batch.rejected_[i]) {
+                continue;
+            }
+            if (kept != i) {
+                memmove(batch.vectors_.data() + kept * dim, batch.vectors_.data() + i * dim, dim * sizeof(float));
+            }
+            batch.ids_.push_back(ids[i]);
+            if (extra_infos != nullptr) {
+                batch.extra_infos_.insert(batch.extra_infos_.end(), extra_infos + i * extra_info_size,
+                                          extra_infos + (i + 1) * extra_info_size);
+            }
+            ++kept;
+        }
+        batch.kept_ids_ = batch.ids_.data();
+        batch.kept_extra_infos_ = extra_infos != nullptr ? batch.extra_infos_.data() : nullptr;
+        batch.kept_count_ = kept;
+        hnsw->get_stats().record_rejected_rows(rejected);
+        vsag::logger::warn("   ingest dropped {} of {} rows, flags:{}", rejected, count, flags);
+    }
+    return rejected;
+}
+
+// rows of build_index converted and checked at a time by the ingest stage
+static const int64_t INGEST_BUILD_CHUNK_ROWS = 64 * 1024;
+
+// add kept rows of one build chunk, hnsw inserts blocks concurrently like its parallel build
+static int add_build_chunk(HnswIndexHandler* hnsw, const vsag::DatasetPtr& chunk, int thread_num)
+{
+    const int64_t num_elements = chunk->GetNumElements();
+    if (HNSW_TYPE != hnsw->get_index_type() || thread_num <= 1 || num_elements <= HNSW_PARALLEL_BUILD_BLOCK_SIZE) {
+        return hnsw->add_index(chunk);
+    }
+    const int dim = chunk->GetDim();
+    const uint64_t extra_info_size = hnsw->get_extra_info_size();
+    const int64_t block_count = (num_elements + HNSW_PARALLEL_BUILD_BLOCK_SIZE - 1) / HNSW_PARALLEL_BUILD_BLOCK_SIZE;
+    std::atomic<int> first_error(0);
+    ObTaskScheduler::instance().parallel_for(hnsw->get_tenant_id(), block_count, thread_num, [&](int64_t i) {
+        if (first_error.load(std::memory_order_relaxed) != 0) {
+            return;
+        }
+        const int64_t start = i * HNSW_PARALLEL_BUILD_BLOCK_SIZE;
+        auto block = vsag::Dataset::Make();
+        block->Dim(dim)
+             ->NumElements(std::min(HNSW_PARALLEL_BUILD_BLOCK_SIZE, num_elements - start))
+             ->Ids(chunk->GetIds() + start)
+             ->Float32Vectors(chunk->GetFloat32Vectors() + start * dim)
+             ->Owner(false);
+        if (chunk->GetExtraInfos() != nullptr) {
+            block->ExtraInfos(chunk->GetExtraInfos() + start * extra_info_size);
+        }
+        if (int ret = hnsw->add_index(block); ret != 0) {
+            int expected = 0;
+            first_error.compare_exchange_strong(expected, ret);
+        }
+    });
+    return first_error.load();
+}
+
+// fp32 copy of the rows of build_index converted and built in one piece, larger inputs are
+// built from a sample and added in INGEST_BUILD_CHUNK_ROWS chunks
+static const int64_t INGEST_BUILD_MAX_BYTES = 1LL << 30;
+
+// rows of the build input picked by gather_rows, contiguous for ingest_batch
+struct ObIngestRows {
+    std::vector<char> vectors_;
+    std::vector<int64_t> ids_;
+    std::vector<char> extra_infos_;
+};
+
+// copy the rows i of [start, end) with pick(i) into rows
+template <typename Pick>
+static void gather_rows(const char* vector_list, int64_t row_size, const int64_t* ids, const char* extra_infos,
+                        uint64_t extra_info_size, int64_t start, int64_t end, Pick pick, ObIngestRows& rows)
+{
+    rows.vectors_.clear();
+    rows.ids_.clear();
+    rows.extra_infos_.clear();
+    for (int64_t i = start; i < end; ++i) {
+        if (!pick(i)) {
+            continue;
+        }
+        rows.vectors_.insert(rows.vectors_.end(), vector_list + i * row_size, vector_list + (i + 1) * row_size);
+        rows.ids_.push_back(ids[i]);
+        if (extra_infos != nullptr) {
+            rows.extra_infos_.insert(rows.extra_infos_.end(), extra_infos + i * extra_info_size,
+                                     extra_infos + (i + 1) * extra_info_size);
+        }
+    }
+}
+
+/*
+ * An input whose fp32 copy fits in INGEST_BUILD_MAX_BYTES is converted once and built as
+ * one dataset, so hgraph uses its build threads and trains the quantizers of
+ * HNSW_SQ_TYPE/HNSW_BQ_TYPE on every row. A larger one is built from a sample of
+ * INGEST_BUILD_CHUNK_ROWS rows taken at a stride across the whole input, which trains the
+ * quantizers, and the other rows are added a chunk at a time.
+ */
+static int ingest_build(HnswIndexHandler* hnsw, const void* vector_list, VectorDataType vector_type,
+                        int64_t* ids, int dim, int size, char* extra_infos, int build_thread_count,
+                        int flags, int64_t* rejected_count)
+{
+    int ret = 0;
+    ObOpRecorder recorder(hnsw->get_stats(), BUILD_OP, ret);
+    SlowTaskTimer t(BUILD_OP, hnsw, ret);
+    t.rows = size;
+    const int64_t row_size = dim * get_vector_type_size(vector_type);
+    const uint64_t extra_info_size = hnsw->get_extra_info_size();
+    const int thread_num = build_thread_count >= 0 ? build_thread_count : hnsw->get_build_thread_count();
+    int64_t rejected = 0;
+    bool built = false;
+    ObIngestBatch batch;
+    // build from the first piece keeping rows, an empty index is still built when every row is dropped
+    auto write_batch = [&](bool is_last) {
+        if (batch.kept_count_ == 0 && (built || !is_last)) {
+            return 0;
+        }
+        auto dataset = vsag::Dataset::Make();
+        dataset->Dim(dim)
+               ->NumElements(batch.kept_count_)
+               ->Ids(batch.kept_ids_)
+               ->Float32Vectors(batch.vectors_.data())
+               ->Owner(false);
+        if (batch.kept_extra_infos_ != nullptr) {
+            dataset->ExtraInfos(batch.kept_extra_infos_);
+        }
+        int write_ret = 0;
+        if (!built) {
+            write_ret = hnsw->build_index(dataset, build_thread_count);
+            built = true;
+        } else {
+            write_ret = add_build_chunk(hnsw, dataset, thread_num);
+        }
+        if (write_ret == 0) {
+            hnsw->get_stats().record_write_rows(batch.kept_count_);
+            hnsw->sample_rows(batch.vectors_.data(), batch.kept_count_);
+        }
+        return write_ret;
+    };
+    if (static_cast<int64_t>(size) * dim * static_cast<int64_t>(sizeof(float)) <= INGEST_BUILD_MAX_BYTES) {
+        rejected += ingest_batch(hnsw, vector_list, vector_type, ids, extra_infos, size, dim, flags, thread_num, batch);
+        ret = write_batch(true);
+    } else {
+        const char* rows_begin = static_cast<const char*>(vector_list);
+        const int64_t stride = (size + INGEST_BUILD_CHUNK_ROWS - 1) / INGEST_BUILD_CHUNK_ROWS;
+        auto is_sampled = [stride](int64_t i) { return i % stride == 0; };
+        auto is_not_sampled = [stride](int64_t i) { return i % stride != 0; };
+        ObIngestRows rows;
+        gather_rows(rows_begin, row_size, ids, extra_infos, extra_info_size, 0, size, is_sampled, rows);
+        rejected += ingest_batch(hnsw, rows.vectors_.data(), vector_type, rows.ids_.data(),
+                                 extra_infos != nullptr ? rows.extra_infos_.data() : nullptr,
+                                 rows.ids_.size(), dim, flags, thread_num, batch);
+        ret = write_batch(stride == 1);
+        for (int64_t start = 0; ret == 0 && stride > 1 && start < size; start += INGEST_BUILD_CHUNK_ROWS) {
+            const int64_t end = std::min<int64_t>(start + INGEST_BUILD_CHUNK_ROWS, size);
+            gather_rows(rows_begin, row_size, ids, extra_infos, extra_info_size, start, end, is_not_sampled, rows);
+            rejected += ingest_batch(hnsw, rows.vectors_.data(), vector_type, rows.ids_.data(),
+                                     extra_infos != nullptr ? rows.extra_infos_.data() : nullptr,
+                                     rows.ids_.size(), dim, flags, thread_num, batch);
+            ret = write_batch(end == size);
+        }
+    }
+    if (rejected_count != nullptr) {
+        *rejected_count = rejected;
+    }
+    if (ret != 0) {
+        vsag::logger::error("   build index error happend, ret={}", ret);
+    }
+    return ret;
+}
+
+static int ingest_add(HnswIndexHandler* hnsw, const void* vector, VectorDataType vector_type,
+                      int64_t* ids, int dim, int size, char* extra_info, int flags, int64_t* rejected_count)
+{
+    int ret = 0;
+    ObOpRecorder recorder(hnsw->get_stats(), ADD_OP, ret);
+    SlowTaskTimer t(ADD_OP, hnsw, ret);
+    t.rows = size;
+    const int64_t type_size = get_vector_type_size(vector_type);
+    const int thread_num = std::max(hnsw->get_build_thread_count(), 1);
+    int64_t rejected = 0;
+    ObIngestBatch batch;
+    for (int64_t start = 0; start < size && ret == 0; start += TYPED_ADD_BLOCK_ROWS) {
+        const int64_t count = std::min<int64_t>(TYPED_ADD_BLOCK_ROWS, size - start);
+        rejected += ingest_batch(hnsw, static_cast<const char*>(vector) + start * dim * type_size, vector_type,
+                                 ids + start,
+                                 extra_info != nullptr ? extra_info + start * hnsw->get_extra_info_size() : nullptr,
+                                 count, dim, flags, thread_num, batch);
+        if (batch.kept_count_ == 0) {
+            continue;
+        }
+        auto incremental = vsag::Dataset::Make();
+        incremental->Dim(dim)
+            ->NumElements(batch.kept_count_)
+            ->Ids(batch.kept_ids_)
+            ->Float32Vectors(batch.vectors_.data())
+            ->Owner(false);
+        if (batch.kept_extra_infos_ != nullptr) {
+            incremental->ExtraInfos(batch.kept_extra_infos_);
+        }
+        if ((ret = hnsw->add_index(incremental)) == 0) {
+            hnsw->get_stats().record_write_rows(batch.kept_count_);
+            hnsw->sample_rows(batch.vectors_.data(), batch.kept_count_);
+        }
+    }
+    if (rejected_count != nullptr) {
+        *rejected_count = rejected;
+    }
+    if (ret != 0) {
+        vsag::logger::error("   add index error happend, ret={}", ret);
+    }
+    return ret;
+}
+
+int build_index(VectorIndexPtr& index_handler, float* vector_list, int64_t* ids, int dim, int size, char *extra_infos/* = nullptr*/,
+                int build_thread_count/* = -1*/) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[build_index]:");
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    int ret =  0;
+    if (index_handler == nullptr || vector_list == nullptr || ids == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}, ids:{}, ids:{}",
+                                                   (void*)index_handler, (void*)vector_list, (void*)ids);
+        return static_cast<int>(error);
+    }
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    if (const int flags = hnsw->get_ingest_flags(); flags != 0) {
+        return ingest_build(hnsw, vector_list, FLOAT32_VECTOR, ids, dim, size, extra_infos, build_thread_count,
+                            flags, nullptr);
+    }
+    ObOpRecorder recorder(hnsw->get_stats(), BUILD_OP, ret);
+    SlowTaskTimer t(BUILD_OP, hnsw, ret);
+    t.rows = size;
+    auto dataset = vsag::Dataset::Make();
+    dataset->Dim(dim)
+           ->NumElements(size)
+           ->Ids(ids)
+           ->Float32Vectors(vector_list)
+           ->Owner(false);
+    if (extra_infos != nullptr) {
+        dataset->ExtraInfos(extra_infos);
+    }
+    ret = hnsw->build_index(dataset, build_thread_count);
+    if (ret != 0) {
+        vsag::logger::error("   build index error happend, ret={}", ret);
+    } else {
+        hnsw->get_stats().record_write_rows(size);
+        hnsw->sample_rows(vector_list, size);
+    }
+    return ret;
+}
+
+
+int add_index(VectorIndexPtr& index_handler, float* vector, int64_t* ids, int dim, int size, char *extra_info/* = nullptr*/) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[add_index]:");
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    int ret = 0;
+    if (index_handler == nullptr || vector == nullptr || ids == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}, ids:{}, ids:{}",
+                                                   (void*)index_handler, (void*)vector, (void*)ids);
+        return static_cast<int>(error);
+    }
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    if (const int flags = hnsw->get_ingest_flags(); flags != 0) {
+        return ingest_add(hnsw, vector, FLOAT32_VECTOR, ids, dim, size, extra_info, flags, nullptr);
+    }
+    ObOpRecorder recorder(hnsw->get_stats(), ADD_OP, ret);
+    SlowTaskTimer t(ADD_OP, hnsw, ret);
+    t.rows = size;
+    // add index
+    auto incremental = vsag::Dataset::Make();
+    incremental->Dim(dim)
+        ->NumElements(size)
+        ->Ids(ids)
+        ->Float32Vectors(vector)
+        ->Owner(false);
+    if (extra_info != nullptr) {
+        incremental->ExtraInfos(extra_info);
+    }
+    ret = hnsw->add_index(incremental);
+    if (ret != 0) {
+        vsag::logger::error("   add index error happend, ret={}", ret);
+    } else {
+        hnsw->get_stats().record_write_rows(size);
+        hnsw->sample_rows(vector, size);
+    }
+    return ret;
+}
+
+// int8 rows of an int8 index are given to vsag as they are, the ingest stage does not apply to them
+static int write_int8_rows(HnswIndexHandler* hnsw, IndexOpType op, const void* vectors, int64_t* ids, int dim,
+                           int size, char* extra_infos, int build_thread_count)
+{
+    int ret = 0;
+    ObOpRecorder recorder(hnsw->get_stats(), op, ret);
+    SlowTaskTimer t(op, hnsw, ret);
+    t.rows = size;
+    auto dataset = vsag::Dataset::Make();
+    dataset->Dim(dim)
+           ->NumElements(size)
+           ->Ids(ids)
+           ->Int8Vectors(static_cast<const int8_t*>(vectors))
+           ->Owner(false);
+    if (extra_infos != nullptr) {
+        dataset->ExtraInfos(extra_infos);
+    }
+    ret = BUILD_OP == op ? hnsw->build_index(dataset, build_thread_count) : hnsw->add_index(dataset);
+    if (ret != 0) {
+        vsag::logger::error("   write int8 rows error happend, ret={}", ret);
+    } else {
+        hnsw->get_stats().record_write_rows(size);
+    }
+    return ret;
+}
+
+// int8 rows and queries are only taken by an index of dtype "int8", which takes no other type
+static int check_vector_type(HnswIndexHandler* hnsw, VectorDataType vector_type)
+{
+    if ((INT8_VECTOR == vector_type) != hnsw->is_int8()) {
+        vsag::logger::error("   vector_type {} not supported by an index of dtype {}",
+                            static_cast<int>(vector_type), hnsw->get_dtype());
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    }
+    return 0;
+}
+
+int build_index(VectorIndexPtr& index_handler, const void* vector_list, VectorDataType vector_type,
+                int64_t* ids, int dim, int size, char *extra_infos/* = nullptr*/, int build_thread_count/* = -1*/,
+                int64_t* rejected_count/* = nullptr*/) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[build_index]: vector_type:{}", static_cast<int>(vector_type));
+    if (index_handler == nullptr || vector_list == nullptr || ids == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}, vector_list:{}, ids:{}",
+                                                   (void*)index_handler, (void*)vector_list, (void*)ids);
+        return static_cast<int>(vsag::ErrorType::UNKNOWN_ERROR);
+    }
+    if (get_vector_type_size(vector_type) == 0 || dim <= 0 || size < 0) {
+        vsag::logger::error("   invalid build argument, vector_type:{}, dim:{}, size:{}",
+                            static_cast<int>(vector_type), dim, size);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    }
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    if (int ret = check_vector_type(hnsw, vector_type); ret != 0) {
+        return ret;
+    }
+    const int flags = hnsw->get_ingest_flags();
+    if (rejected_count != nullptr) {
+        *rejected_count = 0;
+    }
+    if (INT8_VECTOR == vector_type) {
+        return write_int8_rows(hnsw, BUILD_OP, vector_list, ids, dim, size, extra_infos, build_thread_count);
+    } else if (FLOAT32_VECTOR == vector_type && flags == 0) {
+        return build_index(index_handler, static_cast<float*>(const_cast<void*>(vector_list)), ids, dim, size,
+                           extra_infos, build_thread_count);
+    }
+    return ingest_build(hnsw, vector_list, vector_type, ids, dim, size, extra_infos, build_thread_count,
+                        flags, rejected_count);
+}
+
+int add_index(VectorIndexPtr& index_handler, const void* vector, VectorDataType vector_type,
+              int64_t* ids, int dim, int size, char *extra_info/* = nullptr*/, int64_t* rejected_count/* = nullptr*/) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[add_index]: vector_type:{}", static_cast<int>(vector_type));
+    if (index_handler == nullptr || vector == nullptr || ids == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}, vector:{}, ids:{}",
+                                                   (void*)index_handler, (void*)vector, (void*)ids);
+        return static_cast<int>(vsag::ErrorType::UNKNOWN_ERROR);
+    }
+    if (get_vector_type_size(vector_type) == 0 || dim <= 0 || size < 0) {
+        vsag::logger::error("   invalid add argument, vector_type:{}, dim:{}, size:{}",
+                            static_cast<int>(vector_type), dim, size);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    }
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    if (int ret = check_vector_type(hnsw, vector_type); ret != 0) {
+        return ret;
+    }
+    const int flags = hnsw->get_ingest_flags();
+    if (rejected_count != nullptr) {
+        *rejected_count = 0;
+    }
+    if (INT8_VECTOR == vector_type) {
+        return write_int8_rows(hnsw, ADD_OP, vector, ids, dim, size, extra_info, -1);
+    } else if (FLOAT32_VECTOR == vector_type && flags == 0) {
+        return add_index(index_handler, static_cast<float*>(const_cast<void*>(vector)), ids, dim, size, extra_info);
+    }
+    return ingest_add(hnsw, vector, vector_type, ids, dim, size, extra_info, flags, rejected_count);
+}
+
+int set_ingest_options(VectorIndexPtr& index_handler, int flags) {
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    if (index_handler == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
+        return static_cast<int>(error);
+    }
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    if ((flags & ~(INGEST_VALIDATE | INGEST_NORMALIZE)) != 0 || (flags != 0 && hnsw->is_int8())) {
+        // int8 rows are stored as given, they have nothing to validate or normalize
+        vsag::logger::error("   invalid ingest flags:{}, dtype:{}", flags, hnsw->get_dtype());
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    } else if ((flags & INGEST_NORMALIZE) != 0 && 0 != strcmp(hnsw->get_metric(), "cosine")) {
+        // scaling rows changes their l2 and ip distances, only cosine ignores the norm
+        vsag::logger::error("   ingest normalize not supported by metric {}", hnsw->get_metric());
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    }
+    hnsw->set_ingest_flags(flags);
+    return 0;
+}
+
+int update_index(VectorIndexPtr& index_handler, float* vector, int64_t* ids, int dim, int size, char *extra_info/* = nullptr*/) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[update_index]:");
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    int ret = 0;
+    if (index_handler == nullptr || vector == nullptr || ids == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}, vector:{}, ids:{}",
+                                                   (void*)index_handler, (void*)vector, (void*)ids);
+        return static_cast<int>(error);
+    }
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    ObOpRecorder recorder(hnsw->get_stats(), UPDATE_OP, ret);
+    SlowTaskTimer t(UPDATE_OP, hnsw, ret);
+    t.rows = size;
+    if (dim != hnsw->get_dim()) {
+        vsag::logger::error("   update index dim not equal, dim:{}, index dim:{}", dim, hnsw->get_dim());
+        ret = static_cast<int>(vsag::ErrorType::DIMENSION_NOT_EQUAL);
+        return ret;
+    }
+    ObIngestBatch batch;
+    if (const int flags = hnsw->get_ingest_flags(); flags != 0) {
+        // all rows are checked before any is replaced, a dropped row fails the call
+        const int thread_num = std::max(hnsw->get_build_thread_count(), 1);
+        if (ingest_batch(hnsw, vector, FLOAT32_VECTOR, ids, nullptr, size, dim, flags, thread_num, batch) > 0) {
+            vsag::logger::error("   update index rows rejected by the ingest stage, flags:{}", flags);
+            ret = static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+            return ret;
+        }
+        vector = batch.vectors_.data();
+    }
+    if (extra_info != nullptr) {
+        // vsag cannot replace extra infos in place, the rows are removed and added again, the
+        // add drops the old rows tombstoned by the remove before inserting the new ones
+        auto rows = vsag::Dataset::Make();
+        rows->Dim(dim)
+            ->NumElements(size)
+            ->Ids(ids)
+            ->Float32Vectors(vector)
+            ->ExtraInfos(extra_info)
+            ->Owner(false);
+        if ((ret = hnsw->remove_index(ids, size)) == 0) {
+            ret = hnsw->add_index(rows);
+        }
+    } else {
+        ret = hnsw->update_index(vector, ids, dim, size);
+    }
+    if (ret != 0) {
+        vsag::logger::error("   update index error happend, ret={}", ret);
+    } else {
+        hnsw->get_stats().record_write_rows(size);
+    }
+    return ret;
+}
+
+int swap_index(VectorIndexPtr& index_handler, VectorIndexPtr& new_index_handler) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[swap_index]:");
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    int ret = 0;
+    if (index_handler == nullptr || new_index_handler == nullptr || index_handler == new_index_handler) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}, new_index_handler:{}",
+                            (void*)index_handler, (void*)new_index_handler);
+        return static_cast<int>(error);
+    }
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    ret = hnsw->swap_index(*static_cast<HnswIndexHandler*>(new_index_handler));
+    if (ret != 0) {
+        vsag::logger::error("   swap index error happend, ret={}", ret);
+    }
+    return ret;
+}
+
+int remove_index(VectorIndexPtr& index_handler, const int64_t* ids, int64_t count) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[remove_index]:");
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    int ret = 0;
+    if (index_handler == nullptr || (ids == nullptr && count > 0)) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}, ids:{}", (void*)index_handler, (void*)ids);
+        return static_cast<int>(error);
+    } else if (count <= 0) {
+        return 0;
+    }
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    ObOpRecorder recorder(hnsw->get_stats(), REMOVE_OP, ret);
+    SlowTaskTimer t(REMOVE_OP, hnsw, ret);
+    t.rows = count;
+    ret = hnsw->remove_index(ids, count);
+    if (ret != 0) {
+        vsag::logger::error("   remove index error happend, ret={}", ret);
+    } else {
+        hnsw->get_stats().record_write_rows(count);
+    }
+    return ret;
+}
+
+int get_index_stats(VectorIndexPtr& index_handler, IndexStats& stats) {
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    if (index_handler == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
+        return static_cast<int>(error);
+    }
+    static_cast<HnswIndexHandler*>(index_handler)->get_stats().get(stats);
+    return 0;
+}
+
+int get_index_type(VectorIndexPtr& index_handler) {
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    return hnsw->get_index_type(); 
+}
+
+int get_index_number(VectorIndexPtr& index_handler, int64_t &size) {
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    if (index_handler == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
+        return static_cast<int>(error);
+    }
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    size = hnsw->get_index_number();
+    return 0;
+}
+
+// query of the typed entry points widened to fp32, int8 queries are only searched as int8
+static int convert_query(int dim, const void* query_vector, VectorDataType vector_type, std::vector<float>& query)
+{
+    if (query_vector == nullptr || dim <= 0 || get_vector_type_size(vector_type) == 0 || INT8_VECTOR == vector_type) {
+        vsag::logger::error("   invalid query, query_vector:{}, vector_type:{}, dim:{}",
+                            query_vector, static_cast<int>(vector_type), dim);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    }
+    query.resize(dim);
+    convert_to_float(vector_type, query_vector, dim, query.data());
+    return 0;
+}
+
+int cal_distance_by_id(VectorIndexPtr& index_handler, 
+                        const float* vector, 
+                        const int64_t* ids, 
+                        int64_t count, 
+                        const float *&distances)
+{
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    if (index_handler == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
+        return static_cast<int>(error);
+    }
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler); 
+    int ret = hnsw->cal_distance_by_id(vector, ids, count, distances);
+    if (ret != 0) {
+        vsag::logger::error("   knn search error happend, ret={}", ret);
+    } else {
+        hnsw->get_stats().record_distances(count);
+    }
+    return ret;
+}
+
+int cal_distance_by_id(VectorIndexPtr& index_handler, const void* vector, VectorDataType vector_type,
+                       const int64_t* ids, int64_t count, const float *&distances)
+{
+    if (FLOAT32_VECTOR == vector_type) {
+        return cal_distance_by_id(index_handler, static_cast<const float*>(vector), ids, count, distances);
+    }
+    if (index_handler == nullptr || vector == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}, vector:{}", (void*)index_handler, (void*)vector);
+        return static_cast<int>(vsag::ErrorType::UNKNOWN_ERROR);
+    }
+    std::vector<float> query;
+    int ret = convert_query(static_cast<HnswIndexHandler*>(index_handler)->get_dim(), vector, vector_type, query);
+    if (ret == 0) {
+        ret = cal_distance_by_id(index_handler, query.data(), ids, count, distances);
+    }
+    return ret;
+}
+
+extern int get_vid_bound(VectorIndexPtr& index_handler, int64_t &min_vid, int64_t &max_vid)
+{
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    if (index_handler == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
+        return static_cast<int>(error);
+    }
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler); 
+    int ret = hnsw->get_vid_bound(min_vid, max_vid);
+    if (ret != 0) {
+        vsag::logger::error("   get vid bound error happend, ret={}", ret);
+    }
+    return ret;
+}
+
+int knn_search(VectorIndexPtr& index_handler, float* query_vector,int dim, int64_t topk,
+               const float*& dist, const int64_t*& ids, int64_t &result_size, int ef_search,
+               bool need_extra_info, const char*& extra_infos,
+               void* invalid, bool reverse_filter, bool use_extra_info_filter, float valid_ratio) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[knn_search]:");
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    int ret = 0;
+    if (index_handler == nullptr || query_vector == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}, query_vector:{}",
+                                                   (void*)index_handler, (void*)query_vector);
+        return static_cast<int>(error);
+    }
+    FilterInterface *bitmap = static_cast<FilterInterface*>(invalid);
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    ObOpRecorder recorder(hnsw->get_stats(), SEARCH_OP, ret);
+    SlowTaskTimer t(SEARCH_OP, hnsw, ret);
+    ef_search = hnsw->resolve_ef_search(ef_search, topk);
+    hnsw->sample_query(query_vector);
+    const IndexType index_type =static_cast<IndexType>(hnsw->get_index_type());
+    const FilterPlan filter_plan = hnsw->plan_filter(bitmap, reverse_filter, valid_ratio, use_extra_info_filter);
+    const SearchPlan* plan = hnsw->get_search_plan(ef_search, use_extra_info_filter, filter_plan.skip_ratio_);
+    if (filter_plan.exact_scan_) {
+        ret = hnsw->exact_scan(query_vector, topk, bitmap, reverse_filter, dist, ids, result_size,
+                               need_extra_info, extra_infos);
+    } else {
+        auto query = vsag::Dataset::Make();
+        query->NumElements(1)->Dim(dim)->Float32Vectors(query_vector)->Owner(false);
+        ret = hnsw->knn_search(
+            query, topk, plan->parameters_, dist, ids, result_size, filter_plan.valid_ratio_, index_type,
+            bitmap, reverse_filter,
+            need_extra_info, extra_infos);
+    }
+    if (ret != 0) {
+        vsag::logger::error("   knn search error happend, ret={}", ret);
+    } else {
+        hnsw->get_stats().record_queries(1, bitmap != nullptr, result_size);
+        if (bitmap == nullptr) {
+            hnsw->sample_recall(query_vector, topk, ids, result_size);
+        }
+    }
+    t.topk = topk;
+    t.ef_search = plan->ef_search_;
+    t.filtered = bitmap != nullptr;
+    t.valid_ratio = filter_plan.valid_ratio_;
+    t.rows = result_size;
+    return ret;
+}
+
+int knn_search(VectorIndexPtr& index_handler, float* query_vector,int dim, int64_t topk,
+               const float*& dist, const int64_t*& ids, int64_t &result_size, int ef_search,
+               bool need_extra_info, const char*& extra_infos,
+               void* invalid, bool reverse_filter, bool use_extra_info_filter, float valid_ratio, 
+               void *&iter_ctx, bool is_last_search) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[knn_search]:");
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    int ret = 0;
+    if (index_handler == nullptr || query_vector == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}, query_vector:{}",
+                                                   (void*)index_handler, (void*)query_vector);
+        return static_cast<int>(error);
+    }
+    FilterInterface *bitmap = static_cast<FilterInterface*>(invalid);
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    ObOpRecorder recorder(hnsw->get_stats(), SEARCH_OP, ret);
+    SlowTaskTimer t(SEARCH_OP, hnsw, ret);
+    ef_search = hnsw->resolve_ef_search(ef_search, topk);
+    hnsw->sample_query(query_vector);
+    const IndexType index_type =static_cast<IndexType>(hnsw->get_index_type());
+    const SearchPlan* plan = hnsw->get_search_plan(ef_search, use_extra_info_filter);
+    auto query = vsag::Dataset::Make();
+    query->NumElements(1)->Dim(dim)->Float32Vectors(query_vector)->Owner(false);
+    ret = hnsw->knn_search(
+        query, topk, plan->parameters_, dist, ids, result_size, valid_ratio, index_type,
+        bitmap, reverse_filter,
+        need_extra_info, extra_infos, 
+        iter_ctx, is_last_search);
+    if (ret != 0) {
+        vsag::logger::error("   knn search error happend, ret={}", ret);
+    } else {
+        hnsw->get_stats().record_queries(1, bitmap != nullptr, result_size);
+    }
+    t.topk = topk;
+    t.ef_search = plan->ef_search_;
+    t.filtered = bitmap != nullptr;
+    t.valid_ratio = valid_ratio;
+    t.rows = result_size;
+    return ret;
+}
+
+int knn_search_into(VectorIndexPtr& index_handler, float* query_vector, int dim, int64_t topk,
+                    float* dist, int64_t* ids, int64_t &result_size, int ef_search,
+                    bool need_extra_info, char* extra_infos,
+                    void* invalid, bool reverse_filter, bool use_extra_info_filter, float valid_ratio) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[knn_search_into]:");
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    int ret = 0;
+    if (index_handler == nullptr || query_vector == nullptr || dist == nullptr || ids == nullptr
+        || (need_extra_info && extra_infos == nullptr)) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}, query_vector:{}, dist:{}, ids:{}",
+                                                   (void*)index_handler, (void*)query_vector, (void*)dist, (void*)ids);
+        return static_cast<int>(error);
+    }
+    FilterInterface *bitmap = static_cast<FilterInterface*>(invalid);
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    ObOpRecorder recorder(hnsw->get_stats(), SEARCH_OP, ret);
+    SlowTaskTimer t(SEARCH_OP, hnsw, ret);
+    ef_search = hnsw->resolve_ef_search(ef_search, topk);
+    hnsw->sample_query(query_vector);
+    const FilterPlan filter_plan = hnsw->plan_filter(bitmap, reverse_filter, valid_ratio, use_extra_info_filter);
+    const SearchPlan* plan = hnsw->get_search_plan(ef_search, use_extra_info_filter, filter_plan.skip_ratio_);
+    if (filter_plan.exact_scan_) {
+        ret = hnsw->exact_scan(query_vector, topk, bitmap, reverse_filter, dist, ids, result_size,
+                               need_extra_info ? extra_infos : nullptr);
+    } else {
+        auto query = vsag::Dataset::Make();
+        query->NumElements(1)->Dim(dim)->Float32Vectors(query_vector)->Owner(false);
+        ret = hnsw->knn_search_into(query, topk, plan->parameters_, dist, ids, result_size,
+                                    filter_plan.valid_ratio_, bitmap, reverse_filter, need_extra_info, extra_infos);
+    }
+    if (ret != 0) {
+        vsag::logger::error("   knn search error happend, ret={}", ret);
+    } else {
+        hnsw->get_stats().record_queries(1, bitmap != nullptr, result_size);
+        if (bitmap == nullptr) {
+            hnsw->sample_recall(query_vector, topk, ids, result_size);
+        }
+    }
+    t.topk = topk;
+    t.ef_search = plan->ef_search_;
+    t.filtered = bitmap != nullptr;
+    t.valid_ratio = filter_plan.valid_ratio_;
+    t.rows = result_size;
+    return ret;
+}
+
+// search an int8 index with an int8 query through search(query, parameters), the fp32 exact
+// scan and the query and recall sampling do not apply to it
+template <typename Search>
+static int knn_search_int8(HnswIndexHandler* hnsw, const void* query_vector, int dim, int64_t topk, int ef_search,
+                           bool filtered, bool use_extra_info_filter, float valid_ratio, const int64_t& result_size,
+                           Search search)
+{
+    int ret = 0;
+    if (query_vector == nullptr || dim <= 0) {
+        vsag::logger::error("   invalid query, query_vector:{}, dim:{}", query_vector, dim);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    }
+    ObOpRecorder recorder(hnsw->get_stats(), SEARCH_OP, ret);
+    SlowTaskTimer t(SEARCH_OP, hnsw, ret);
+    ef_search = hnsw->resolve_ef_search(ef_search, topk);
+    const SearchPlan* plan = hnsw->get_search_plan(ef_search, use_extra_info_filter);
+    auto query = vsag::Dataset::Make();
+    query->NumElements(1)->Dim(dim)->Int8Vectors(static_cast<const int8_t*>(query_vector))->Owner(false);
+    ret = search(query, plan->parameters_);
+    if (ret != 0) {
+        vsag::logger::error("   knn search error happend, ret={}", ret);
+    } else {
+        hnsw->get_stats().record_queries(1, filtered, result_size);
+    }
+    t.topk = topk;
+    t.ef_search = plan->ef_search_;
+    t.filtered = filtered;
+    t.valid_ratio = valid_ratio;
+    t.rows = result_size;
+    return ret;
+}
+
+int knn_search(VectorIndexPtr& index_handler, const void* query_vector, VectorDataType vector_type,
+               int dim, int64_t topk,
+               const float*& dist, const int64_t*& ids, int64_t &result_size, int ef_search,
+               bool need_extra_info, const char*& extra_infos,
+               void* invalid, bool reverse_filter, bool use_extra_info_filter, float valid_ratio) {
+    if (FLOAT32_VECTOR == vector_type) {
+        return knn_search(index_handler, static_cast<float*>(const_cast<void*>(query_vector)), dim, topk,
+                          dist, ids, result_size, ef_search, need_extra_info, extra_infos,
+                          invalid, reverse_filter, use_extra_info_filter, valid_ratio);
+    } else if (INT8_VECTOR == vector_type && index_handler != nullptr) {
+        HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+        if (int ret = check_vector_type(hnsw, vector_type); ret != 0) {
+            return ret;
+        }
+        FilterInterface *bitmap = static_cast<FilterInterface*>(invalid);
+        const int index_type = hnsw->get_index_type();
+        return knn_search_int8(hnsw, query_vector, dim, topk, ef_search, bitmap != nullptr, use_extra_info_filter,
+                               valid_ratio, result_size,
+                               [&](const vsag::DatasetPtr& query, const std::string& parameters) {
+            return hnsw->knn_search(query, topk, parameters, dist, ids, result_size, valid_ratio, index_type,
+                                    bitmap, reverse_filter, need_extra_info, extra_infos);
+        });
     }
-    ret = static_cast<int>(error);
-    if (ret != 0) {
-        vsag::logger::error("   create index error happend, ret={}", static_cast<int>(error));
+    std::vector<float> query;
+    int ret = convert_query(dim, query_vector, vector_type, query);
+    if (ret == 0) {
+        ret = knn_search(index_handler, query.data(), dim, topk, dist, ids, result_size, ef_search,
+                         need_extra_info, extra_infos, invalid, reverse_filter, use_extra_info_filter, valid_ratio);
+    }
+    return ret;
+}
+
+int knn_search_into(VectorIndexPtr& index_handler, const void* query_vector, VectorDataType vector_type,
+                    int dim, int64_t topk,
+                    float* dist, int64_t* ids, int64_t &result_size, int ef_search,
+                    bool need_extra_info, char* extra_infos,
+                    void* invalid, bool reverse_filter, bool use_extra_info_filter, float valid_ratio) {
+    if (FLOAT32_VECTOR == vector_type) {
+        return knn_search_into(index_handler, static_cast<float*>(const_cast<void*>(query_vector)), dim, topk,
+                               dist, ids, result_size, ef_search, need_extra_info, extra_infos,
+                               invalid, reverse_filter, use_extra_info_filter, valid_ratio);
+    } else if (INT8_VECTOR == vector_type && index_handler != nullptr) {
+        HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+        if (int ret = check_vector_type(hnsw, vector_type); ret != 0) {
+            return ret;
+        } else if (dist == nullptr || ids == nullptr || (need_extra_info && extra_infos == nullptr)) {
+            OB_VSAG_LOG_DEBUG("   null pointer addr, dist:{}, ids:{}", (void*)dist, (void*)ids);
+            return static_cast<int>(vsag::ErrorType::UNKNOWN_ERROR);
+        }
+        FilterInterface *bitmap = static_cast<FilterInterface*>(invalid);
+        return knn_search_int8(hnsw, query_vector, dim, topk, ef_search, bitmap != nullptr, use_extra_info_filter,
+                               valid_ratio, result_size,
+                               [&](const vsag::DatasetPtr& query, const std::string& parameters) {
+            return hnsw->knn_search_into(query, topk, parameters, dist, ids, result_size, valid_ratio,
+                                         bitmap, reverse_filter, need_extra_info, extra_infos);
+        });
+    }
+    std::vector<float> query;
+    int ret = convert_query(dim, query_vector, vector_type, query);
+    if (ret == 0) {
+        ret = knn_search_into(index_handler, query.data(), dim, topk, dist, ids, result_size, ef_search,
+                              need_extra_info, extra_infos, invalid, reverse_filter, use_extra_info_filter, valid_ratio);
     }
     return ret;
 }
 
-int build_index(VectorIndexPtr& index_handler, float* vector_list, int64_t* ids, int dim, int size, char *extra_infos/* = nullptr*/) {
-    vsag::logger::debug("TRACE LOG[build_index]:");
+int range_search(VectorIndexPtr& index_handler, float* query_vector, int dim, float radius, int64_t limit,
+                 float* dist, int64_t* ids, int64_t &result_size, int ef_search,
+                 bool need_extra_info, char* extra_infos,
+                 void* invalid, bool reverse_filter, bool use_extra_info_filter, float valid_ratio) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[range_search]:");
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
-    int ret =  0;
-    if (index_handler == nullptr || vector_list == nullptr || ids == nullptr) {
-        vsag::logger::debug("   null pointer addr, index_handler:{}, ids:{}, ids:{}",
-                                                   (void*)index_handler, (void*)vector_list, (void*)ids);
+    int ret = 0;
+    if (index_handler == nullptr || query_vector == nullptr || dist == nullptr || ids == nullptr
+        || (need_extra_info && extra_infos == nullptr)) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}, query_vector:{}, dist:{}, ids:{}",
+                                                   (void*)index_handler, (void*)query_vector, (void*)dist, (void*)ids);
         return static_cast<int>(error);
     }
-    // SlowTaskTimer t("build_index");
-    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
-    auto dataset = vsag::Dataset::Make();
-    dataset->Dim(dim)
-           ->NumElements(size)
-           ->Ids(ids)
-           ->Float32Vectors(vector_list)
-           ->Owner(false);
-    if (extra_infos != nullptr) {
-        dataset->ExtraInfos(extra_infos);
+    if (limit <= 0) {
+        vsag::logger::error("   invalid range search limit:{}", limit);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
     }
-    ret = hnsw->build_index(dataset);
+    FilterInterface *bitmap = static_cast<FilterInterface*>(invalid);
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    ObOpRecorder recorder(hnsw->get_stats(), SEARCH_OP, ret);
+    SlowTaskTimer t(SEARCH_OP, hnsw, ret);
+    const SearchPlan* plan = hnsw->get_search_plan(ef_search > 0 ? ef_search : hnsw->get_ef_search(),
+                                                   use_extra_info_filter);
+    auto query = vsag::Dataset::Make();
+    query->NumElements(1)->Dim(dim)->Float32Vectors(query_vector)->Owner(false);
+    ret = hnsw->range_search(query, radius, limit, plan->parameters_, dist, ids, result_size,
+                             valid_ratio < 0 ? 1.0f : valid_ratio, bitmap, reverse_filter, need_extra_info, extra_infos);
     if (ret != 0) {
-        vsag::logger::error("   build index error happend, ret={}", ret);
+        vsag::logger::error("   range search error happend, ret={}", ret);
+    } else {
+        hnsw->get_stats().record_queries(1, bitmap != nullptr, result_size);
     }
+    t.topk = limit;
+    t.ef_search = plan->ef_search_;
+    t.filtered = bitmap != nullptr;
+    t.valid_ratio = valid_ratio;
+    t.rows = result_size;
     return ret;
 }
 
-
-int add_index(VectorIndexPtr& index_handler, float* vector, int64_t* ids, int dim, int size, char *extra_info/* = nullptr*/) {
-    vsag::logger::debug("TRACE LOG[add_index]:");
+int knn_search_batch(VectorIndexPtr& index_handler, const float* query_vectors, int dim,
+                     int64_t query_count, const int64_t* topks, const int* ef_searches,
+                     float* dists, int64_t* ids, int64_t* result_sizes,
+                     bool need_extra_info, char* extra_infos,
+                     void** filters, int64_t filter_count, bool reverse_filter,
+                     bool use_extra_info_filter, float valid_ratio, int thread_num) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[knn_search_batch]:");
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
     int ret = 0;
-    if (index_handler == nullptr || vector == nullptr || ids == nullptr) {
-        vsag::logger::debug("   null pointer addr, index_handler:{}, ids:{}, ids:{}",
-                                                   (void*)index_handler, (void*)vector, (void*)ids);
+    if (index_handler == nullptr || query_vectors == nullptr || topks == nullptr || ef_searches == nullptr
+        || dists == nullptr || ids == nullptr || result_sizes == nullptr
+        || (need_extra_info && extra_infos == nullptr)) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}, query_vectors:{}, topks:{}, ef_searches:{}",
+                                                   (void*)index_handler, (void*)query_vectors, (void*)topks, (void*)ef_searches);
         return static_cast<int>(error);
     }
+    if (filters == nullptr) {
+        filter_count = 0;
+    }
+    if (query_count <= 0) {
+        OB_VSAG_LOG_DEBUG("   invalid query count:{}", query_count);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    } else if (filter_count != 0 && filter_count != 1 && filter_count != query_count) {
+        OB_VSAG_LOG_DEBUG("   invalid filter count:{}, query count:{}", filter_count, query_count);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    }
+    // queries failing or skipped after an error report no result
+    std::fill(result_sizes, result_sizes + query_count, 0);
     HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
-    // SlowTaskTimer t("add_index");
-    // add index
-    auto incremental = vsag::Dataset::Make();
-    incremental->Dim(dim)
-        ->NumElements(size)
-        ->Ids(ids)
-        ->Float32Vectors(vector)
-        ->Owner(false);
-    if (extra_info != nullptr) {
-        incremental->ExtraInfos(extra_info);
+    ObOpRecorder recorder(hnsw->get_stats(), SEARCH_BATCH_OP, ret);
+    SlowTaskTimer t(SEARCH_BATCH_OP, hnsw, ret);
+    std::vector<const SearchPlan*> plans(query_count);
+    for (int64_t i = 0; i < query_count; ++i) {
+        int ef_search = hnsw->resolve_ef_search(ef_searches[i], topks[i]);
+        plans[i] = (i > 0 && ef_search == plans[i - 1]->ef_search_)
+                       ? plans[i - 1]
+                       : hnsw->get_search_plan(ef_search, use_extra_info_filter);
     }
-    ret = hnsw->add_index(incremental);
+    ret = hnsw->knn_search_batch(query_vectors, dim, query_count, topks, plans,
+                                 dists, ids, result_sizes, valid_ratio,
+                                 reinterpret_cast<FilterInterface**>(filters), filter_count,
+                                 reverse_filter, need_extra_info, extra_infos, thread_num);
     if (ret != 0) {
-        vsag::logger::error("   add index error happend, ret={}", ret);
+        vsag::logger::error("   knn search batch error happend, ret={}", ret);
+    } else {
+        int64_t result_rows = 0;
+        for (int64_t i = 0; i < query_count; ++i) {
+            result_rows += result_sizes[i];
+        }
+        hnsw->get_stats().record_queries(query_count, filter_count > 0, result_rows);
+        t.rows = result_rows;
     }
+    t.topk = topks[0];
+    t.ef_search = plans[0]->ef_search_;
+    t.filtered = filter_count > 0;
+    t.valid_ratio = valid_ratio;
     return ret;
 }
 
-int get_index_type(VectorIndexPtr& index_handler) {
-    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
-    return hnsw->get_index_type(); 
-}
-
-int get_index_number(VectorIndexPtr& index_handler, int64_t &size) {
+int get_search_plan(VectorIndexPtr& index_handler, int ef_search, bool use_extra_info_filter,
+                    float skip_ratio, SearchPlanPtr& search_plan) {
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
     if (index_handler == nullptr) {
-        vsag::logger::debug("   null pointer addr, index_handler:{}", (void*)index_handler);
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
         return static_cast<int>(error);
     }
     HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
-    size = hnsw->get_index_number();
+    search_plan = const_cast<SearchPlan*>(hnsw->get_search_plan(ef_search, use_extra_info_filter, skip_ratio));
     return 0;
 }
 
-int cal_distance_by_id(VectorIndexPtr& index_handler, 
-                        const float* vector, 
-                        const int64_t* ids, 
-                        int64_t count, 
-                        const float *&distances)
-{
+int knn_search_with_plan(VectorIndexPtr& index_handler, SearchPlanPtr search_plan,
+                         float* query_vector, int dim, int64_t topk,
+                         const float*& dist, const int64_t*& ids, int64_t &result_size,
+                         bool need_extra_info, const char*& extra_infos,
+                         void* invalid, bool reverse_filter, float valid_ratio) {
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
-    if (index_handler == nullptr) {
-        vsag::logger::debug("   null pointer addr, index_handler:{}", (void*)index_handler);
+    int ret = 0;
+    if (index_handler == nullptr || search_plan == nullptr || query_vector == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}, search_plan:{}, query_vector:{}",
+                                                   (void*)index_handler, search_plan, (void*)query_vector);
         return static_cast<int>(error);
     }
-    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler); 
-    int ret = hnsw->cal_distance_by_id(vector, ids, count, distances);
+    FilterInterface *bitmap = static_cast<FilterInterface*>(invalid);
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    ObOpRecorder recorder(hnsw->get_stats(), SEARCH_OP, ret);
+    SlowTaskTimer t(SEARCH_OP, hnsw, ret);
+    const SearchPlan* plan = static_cast<const SearchPlan*>(search_plan);
+    // the skip ratio of the plan given by the caller is kept
+    const FilterPlan filter_plan = hnsw->plan_filter(bitmap, reverse_filter, valid_ratio, plan->use_extra_info_filter_);
+    if (filter_plan.exact_scan_) {
+        ret = hnsw->exact_scan(query_vector, topk, bitmap, reverse_filter, dist, ids, result_size,
+                               need_extra_info, extra_infos);
+    } else {
+        auto query = vsag::Dataset::Make();
+        query->NumElements(1)->Dim(dim)->Float32Vectors(query_vector)->Owner(false);
+        ret = hnsw->knn_search(
+            query, topk, plan->parameters_, dist, ids, result_size, filter_plan.valid_ratio_, hnsw->get_index_type(),
+            bitmap, reverse_filter,
+            need_extra_info, extra_infos);
+    }
     if (ret != 0) {
         vsag::logger::error("   knn search error happend, ret={}", ret);
+    } else {
+        hnsw->get_stats().record_queries(1, bitmap != nullptr, result_size);
+        if (bitmap == nullptr) {
+            hnsw->sample_recall(query_vector, topk, ids, result_size);
+        }
     }
+    t.topk = topk;
+    t.ef_search = plan->ef_search_;
+    t.filtered = bitmap != nullptr;
+    t.valid_ratio = filter_plan.valid_ratio_;
+    t.rows = result_size;
     return ret;
 }
 
-extern int get_vid_bound(VectorIndexPtr& index_handler, int64_t &min_vid, int64_t &max_vid)
-{
-    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
-    if (index_handler == nullptr) {
-        vsag::logger::debug("   null pointer addr, index_handler:{}", (void*)index_handler);
-        return static_cast<int>(error);
+int exact_search(const float* base, const int64_t* base_ids, int64_t base_count, int dim, const char* metric,
+                 const float* query_vectors, int64_t query_count, int64_t topk,
+                 float* dists, int64_t* ids, int64_t* result_sizes,
+                 void* invalid, bool reverse_filter, int thread_num) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[exact_search]:");
+    if (base == nullptr || query_vectors == nullptr || dists == nullptr || ids == nullptr || result_sizes == nullptr) {
+        vsag::logger::error("   null pointer addr, base:{}, query_vectors:{}, dists:{}, ids:{}",
+                            (void*)base, (void*)query_vectors, (void*)dists, (void*)ids);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    } else if (base_count <= 0 || query_count <= 0 || dim <= 0 || topk < 0) {
+        vsag::logger::error("   invalid exact search, base_count:{}, query_count:{}, dim:{}, topk:{}",
+                            base_count, query_count, dim, topk);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
     }
-    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler); 
-    int ret = hnsw->get_vid_bound(min_vid, max_vid);
+    int ret = exact_knn(get_distance_type(metric), base, base_ids, base_count, dim, query_vectors, query_count, topk,
+                        static_cast<FilterInterface*>(invalid), reverse_filter,
+                        ObTaskScheduler::DEFAULT_TENANT_ID, thread_num, dists, ids, result_sizes);
     if (ret != 0) {
-        vsag::logger::error("   get vid bound error happend, ret={}", ret);
+        vsag::logger::error("   exact search error happend, ret={}", ret);
     }
     return ret;
 }
 
-int knn_search(VectorIndexPtr& index_handler, float* query_vector,int dim, int64_t topk,
-               const float*& dist, const int64_t*& ids, int64_t &result_size, int ef_search,
-               bool need_extra_info, const char*& extra_infos,
-               void* invalid, bool reverse_filter, bool use_extra_info_filter, float valid_ratio) {
-    vsag::logger::debug("TRACE LOG[knn_search]:");
+int exact_search(VectorIndexPtr& index_handler, const float* query_vectors, int dim,
+                 int64_t query_count, int64_t topk,
+                 float* dists, int64_t* ids, int64_t* result_sizes,
+                 void* invalid, bool reverse_filter, int thread_num) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[exact_search]:");
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
-    int ret = 0;
-    if (index_handler == nullptr || query_vector == nullptr) {
-        vsag::logger::debug("   null pointer addr, index_handler:{}, query_vector:{}",
-                                                   (void*)index_handler, (void*)query_vector);
+    if (index_handler == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
         return static_cast<int>(error);
+    } else if (query_vectors == nullptr || dists == nullptr || ids == nullptr || result_sizes == nullptr) {
+        vsag::logger::error("   null pointer addr, query_vectors:{}, dists:{}, ids:{}",
+                            (void*)query_vectors, (void*)dists, (void*)ids);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
     }
-    // SlowTaskTimer t("knn_search");
-    FilterInterface *bitmap = static_cast<FilterInterface*>(invalid);
-    bool owner_set = false;
-    nlohmann::json search_parameters;
     HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
-    const IndexType index_type =static_cast<IndexType>(hnsw->get_index_type());
-    if (HNSW_SQ_TYPE == index_type || HNSW_BQ_TYPE == index_type || HGRAPH_TYPE == index_type) {
-        search_parameters = {{"hgraph", {{"ef_search", ef_search}, {"use_extra_info_filter", use_extra_info_filter}}},};
-        owner_set = true;
-    } else {
-        search_parameters = {{"hnsw", {{"ef_search", ef_search}, {"skip_ratio", 0.7f}}},};
+    if (query_count <= 0 || topk < 0) {
+        vsag::logger::error("   invalid exact search, query_count:{}, topk:{}", query_count, topk);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    } else if (dim != hnsw->get_dim()) {
+        vsag::logger::error("   query dim {} not equal to index dim {}", dim, hnsw->get_dim());
+        return static_cast<int>(vsag::ErrorType::DIMENSION_NOT_EQUAL);
     }
-    auto query = vsag::Dataset::Make();
-    query->NumElements(1)->Dim(dim)->Float32Vectors(query_vector)->Owner(false);
-    ret = hnsw->knn_search(
-        query, topk, search_parameters.dump(), dist, ids, result_size, valid_ratio, index_type,
-        bitmap, reverse_filter,
-        need_extra_info, extra_infos);
+    int ret = hnsw->exact_search(query_vectors, query_count, topk, static_cast<FilterInterface*>(invalid),
+                                 reverse_filter, thread_num, dists, ids, result_sizes);
     if (ret != 0) {
-        vsag::logger::error("   knn search error happend, ret={}", ret);
+        vsag::logger::error("   exact search error happend, ret={}", ret);
     }
     return ret;
 }
 
-int knn_search(VectorIndexPtr& index_handler, float* query_vector,int dim, int64_t topk,
-               const float*& dist, const int64_t*& ids, int64_t &result_size, int ef_search,
-               bool need_extra_info, const char*& extra_infos,
-               void* invalid, bool reverse_filter, bool use_extra_info_filter, float valid_ratio, 
-               void *&iter_ctx, bool is_last_search) {
-    vsag::logger::debug("TRACE LOG[knn_search]:");
+int evaluate_recall(VectorIndexPtr& index_handler, const float* query_vectors, int dim,
+                    int64_t query_count, int64_t topk, int ef_search, float& recall,
+                    void* invalid, bool reverse_filter, int thread_num) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[evaluate_recall]:");
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
-    int ret = 0;
-    if (index_handler == nullptr || query_vector == nullptr) {
-        vsag::logger::debug("   null pointer addr, index_handler:{}, query_vector:{}",
-                                                   (void*)index_handler, (void*)query_vector);
+    if (index_handler == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
         return static_cast<int>(error);
+    } else if (query_vectors == nullptr) {
+        vsag::logger::error("   null pointer addr, query_vectors:{}", (void*)query_vectors);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
     }
-    // SlowTaskTimer t("knn_search");
-    FilterInterface *bitmap = static_cast<FilterInterface*>(invalid);
-    bool owner_set = false;
-    nlohmann::json search_parameters;
     HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
-    const IndexType index_type =static_cast<IndexType>(hnsw->get_index_type());
-    if (HNSW_SQ_TYPE == index_type || HNSW_BQ_TYPE == index_type || HGRAPH_TYPE == index_type) {
-        search_parameters = {{"hgraph", {{"ef_search", ef_search}, {"use_extra_info_filter", use_extra_info_filter}}},};
-        owner_set = true;
-    } else {
-        search_parameters = {{"hnsw", {{"ef_search", ef_search}, {"skip_ratio", 0.7f}}},};
+    if (query_count <= 0 || topk < 0) {
+        vsag::logger::error("   invalid evaluate recall, query_count:{}, topk:{}", query_count, topk);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    } else if (dim != hnsw->get_dim()) {
+        vsag::logger::error("   query dim {} not equal to index dim {}", dim, hnsw->get_dim());
+        return static_cast<int>(vsag::ErrorType::DIMENSION_NOT_EQUAL);
     }
-    auto query = vsag::Dataset::Make();
-    query->NumElements(1)->Dim(dim)->Float32Vectors(query_vector)->Owner(false);
-    ret = hnsw->knn_search(
-        query, topk, search_parameters.dump(), dist, ids, result_size, valid_ratio, index_type,
-        bitmap, reverse_filter,
-        need_extra_info, extra_infos, 
-        iter_ctx, is_last_search);
+    int64_t hit_count = 0;
+    int64_t expected_count = 0;
+    int ret = hnsw->evaluate_recall(query_vectors, query_count, topk, ef_search, static_cast<FilterInterface*>(invalid),
+                                    reverse_filter, thread_num, hit_count, expected_count);
     if (ret != 0) {
-        vsag::logger::error("   knn search error happend, ret={}", ret);
+        vsag::logger::error("   evaluate recall error happend, ret={}", ret);
+        return ret;
     }
-    return ret;
+    recall = expected_count == 0 ? 1.0 : static_cast<float>(hit_count) / expected_count;
+    OB_VSAG_LOG_DEBUG("   recall:{}, hit:{}, expected:{}", recall, hit_count, expected_count);
+    return 0;
+}
+
+int set_recall_target(VectorIndexPtr& index_handler, float target_recall) {
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    if (index_handler == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
+        return static_cast<int>(error);
+    } else if (target_recall > 1) {
+        vsag::logger::error("   invalid recall target:{}", target_recall);
+        return static_cast<int>(vsag::ErrorType::INVALID_ARGUMENT);
+    }
+    static_cast<HnswIndexHandler*>(index_handler)->set_recall_target(target_recall);
+    return 0;
+}
+
+int get_tuned_ef_search(VectorIndexPtr& index_handler, int64_t topk, int& ef_search) {
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    if (index_handler == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
+        return static_cast<int>(error);
+    }
+    ef_search = static_cast<HnswIndexHandler*>(index_handler)->resolve_ef_search(0, topk);
+    return 0;
+}
+
+void set_filter_planner(int64_t max_rows, float max_ratio) {
+    exact_scan_max_rows.store(max_rows);
+    exact_scan_ratio.store(max_ratio);
+    vsag::logger::info("   set filter planner, exact scan max rows:{}, max ratio:{}", max_rows, max_ratio);
+}
+
+void set_recall_check_budget(int64_t max_distances) {
+    recall_check_budget.store(std::max<int64_t>(max_distances, 0));
+    vsag::logger::info("   set recall check budget, max distances:{}", recall_check_budget.load());
+}
+
+int set_recall_monitor(VectorIndexPtr& index_handler, int64_t sample_interval, float min_recall) {
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    if (index_handler == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
+        return static_cast<int>(error);
+    }
+    static_cast<HnswIndexHandler*>(index_handler)->set_recall_monitor(sample_interval, min_recall);
+    return 0;
+}
+
+// removed rows not yet repaired are saved with the index: as a section of the index file,
+// or in the header fserialize writes before the vsag stream
+static const char* TOMBSTONE_SECTION_KEY = "ob_tombstones";
+
+/*
+ * Stream layout written by fserialize:
+ *
+ *   header  | magic "OBVSAGST", version, tombstones size
+ *   data    | tombstones, then the vsag stream as Index::Serialize writes it
+ *
+ * Integers are little endian. Streams of older versions hold the vsag stream alone and
+ * are told apart by the magic.
+ */
+static const char INDEX_STREAM_MAGIC[8] = {'O', 'B', 'V', 'S', 'A', 'G', 'S', 'T'};
+static const uint32_t INDEX_STREAM_VERSION = 1;
+static const uint64_t INDEX_STREAM_HEADER_SIZE = sizeof(INDEX_STREAM_MAGIC) + sizeof(uint32_t) + sizeof(uint64_t);
+
+static void serialize_tombstones(const TombstoneSnapshot& tombstones, vsag::Binary& binary)
+{
+    binary.size = roaring::api::roaring64_bitmap_portable_size_in_bytes(tombstones.get());
+    binary.data.reset(new int8_t[binary.size]);
+    roaring::api::roaring64_bitmap_portable_serialize(tombstones.get(), reinterpret_cast<char*>(binary.data.get()));
+}
+
+static int deserialize_tombstones(const char* data, size_t size, TombstoneSnapshot& tombstones)
+{
+    roaring::api::roaring64_bitmap_t* bitmap = roaring::api::roaring64_bitmap_portable_deserialize_safe(data, size);
+    if (bitmap == nullptr) {
+        vsag::logger::error("   invalid tombstones, size:{}", size);
+        return static_cast<int>(vsag::ErrorType::INVALID_BINARY);
+    }
+    tombstones = make_tombstone_snapshot(bitmap);
+    return 0;
+}
+
+// tombstones are read in chunks of this size from streams whose length is unknown
+static const uint64_t TOMBSTONE_READ_CHUNK_SIZE = 1 << 20;
+
+static void put_le(char* buf, uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        buf[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+static uint64_t get_le(const char* buf, size_t size)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(buf[i])) << (8 * i);
+    }
+    return value;
+}
+
+// bytes already read from a stream that cannot seek, read again in front of the rest of it
+class ObPrefixStreambuf : public std::streambuf
+{
+public:
+    ObPrefixStreambuf(const std::string& prefix, std::streambuf* rest) : prefix_(prefix), rest_(rest) {
+        setg(&prefix_[0], &prefix_[0], &prefix_[0] + prefix_.size());
+    }
+
+protected:
+    int_type underflow() override {
+        return gptr() < egptr() ? traits_type::to_int_type(*gptr()) : rest_->sgetc();
+    }
+    int_type uflow() override {
+        if (gptr() < egptr()) {
+            int_type c = traits_type::to_int_type(*gptr());
+            gbump(1);
+            return c;
+        }
+        return rest_->sbumpc();
+    }
+    std::streamsize xsgetn(char* s, std::streamsize n) override {
+        std::streamsize count = std::min<std::streamsize>(n, egptr() - gptr());
+        memcpy(s, gptr(), count);
+        gbump(static_cast<int>(count));
+        return count < n ? count + rest_->sgetn(s + count, n - count) : count;
+    }
+
+private:
+    std::string prefix_;
+    std::streambuf* rest_;
+};
+
+/*
+ * Read the header of fserialize and the tombstones following it. A stream without the
+ * header is seeked back to where it started, or, when it cannot seek, the bytes read are
+ * returned in consumed so that the vsag stream can be read through ObPrefixStreambuf.
+ */
+static int read_stream_header(std::istream& in_stream, TombstoneSnapshot& tombstones, std::string& consumed)
+{
+    const std::istream::pos_type start = in_stream.tellg();
+    char header[INDEX_STREAM_HEADER_SIZE];
+    in_stream.read(header, sizeof(INDEX_STREAM_MAGIC));
+    if (in_stream.gcount() != static_cast<std::streamsize>(sizeof(INDEX_STREAM_MAGIC))
+        || 0 != memcmp(header, INDEX_STREAM_MAGIC, sizeof(INDEX_STREAM_MAGIC))) {
+        in_stream.clear();
+        if (start != std::istream::pos_type(-1)) {
+            in_stream.seekg(start);
+        } else {
+            consumed.assign(header, in_stream.gcount());
+        }
+        return 0;
+    }
+    if (!in_stream.read(header + sizeof(INDEX_STREAM_MAGIC), INDEX_STREAM_HEADER_SIZE - sizeof(INDEX_STREAM_MAGIC))) {
+        vsag::logger::error("   read index stream header error happend");
+        return static_cast<int>(vsag::ErrorType::READ_ERROR);
+    }
+    const uint32_t version = static_cast<uint32_t>(get_le(header + sizeof(INDEX_STREAM_MAGIC), sizeof(uint32_t)));
+    const uint64_t size = get_le(header + sizeof(INDEX_STREAM_MAGIC) + sizeof(uint32_t), sizeof(uint64_t));
+    if (version != INDEX_STREAM_VERSION) {
+        vsag::logger::error("   unsupported index stream version:{}", version);
+        return static_cast<int>(vsag::ErrorType::INVALID_BINARY);
+    }
+    if (size == 0) {
+        return 0;
+    }
+    // the size comes from the stream, check it against what is left before allocating
+    const std::istream::pos_type data_start = in_stream.tellg();
+    if (data_start != std::istream::pos_type(-1)) {
+        in_stream.seekg(0, std::ios::end);
+        const std::istream::pos_type end = in_stream.tellg();
+        in_stream.seekg(data_start);
+        if (end == std::istream::pos_type(-1) || size > static_cast<uint64_t>(end - data_start)) {
+            vsag::logger::error("   invalid tombstones size:{}", size);
+            return static_cast<int>(vsag::ErrorType::INVALID_BINARY);
+        }
+    }
+    std::vector<char> data;
+    while (data.size() < size) {
+        const uint64_t offset = data.size();
+        data.resize(offset + std::min(size - offset, TOMBSTONE_READ_CHUNK_SIZE));
+        if (!in_stream.read(data.data() + offset, data.size() - offset)) {
+            vsag::logger::error("   read tombstones error happend, size:{}", size);
+            return static_cast<int>(vsag::ErrorType::READ_ERROR);
+        }
+    }
+    return deserialize_tombstones(data.data(), size, tombstones);
 }
 
 int serialize(VectorIndexPtr& index_handler, const std::string dir) {
-    vsag::logger::debug("TRACE LOG[serialize]:");
+    OB_VSAG_LOG_DEBUG("TRACE LOG[serialize]:");
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
     int ret =  0;
     if (index_handler == nullptr) {
-        vsag::logger::debug("   null pointer addr, index_handler:{}", (void*)index_handler);
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
         return static_cast<int>(error);
     }
     HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
-    if (auto bs = hnsw->get_index()->Serialize(); bs.has_value()) {
+    ObOpRecorder recorder(hnsw->get_stats(), SERIALIZE_OP, ret);
+    SlowTaskTimer t(SERIALIZE_OP, hnsw, ret);
+    ObSerializeGuard guard(hnsw->get_index_lock());
+    IndexSnapshotPtr snapshot = hnsw->get_snapshot();
+    const TombstoneSnapshot& tombstones = snapshot->tombstones_;
+    if (auto bs = snapshot->index_->Serialize(); bs.has_value()) {
         hnsw = nullptr;
-        auto keys = bs->GetKeys();
-        for (auto key : keys) {
-            vsag::Binary b = bs->Get(key);
-            std::ofstream file(dir + "hnsw.index." + key, std::ios::binary);
-            file.write((const char*)b.data.get(), b.size);
-            file.close();
-        }
-        std::ofstream metafile(dir + "hnsw.index._meta", std::ios::out);
-        for (auto key : keys) {
-            metafile << key << std::endl;
-        }
-        metafile.close();
-        return 0;
+        if (tombstones != nullptr) {
+            vsag::Binary binary;
+            serialize_tombstones(tombstones, binary);
+            bs.value().Set(TOMBSTONE_SECTION_KEY, binary);
+        }
+        ret = ObIndexFile::write(dir + "hnsw.index", bs.value());
     } else {
         error = bs.error().type;
+        ret = static_cast<int>(error);
     }
-    ret = static_cast<int>(error);
     if (ret != 0) {
         vsag::logger::error("   serialize error happend, ret={}", ret);
     }
@@ -682,15 +3843,37 @@ int serialize(VectorIndexPtr& index_handler, const std::string dir) {
 }
 
 int fserialize(VectorIndexPtr& index_handler, std::ostream& out_stream) {
-    vsag::logger::debug("TRACE LOG[fserialize]:");
+    OB_VSAG_LOG_DEBUG("TRACE LOG[fserialize]:");
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
     int ret = 0;
     if (index_handler == nullptr) {
-        vsag::logger::debug("   null pointer addr, index_handler:{}", (void*)index_handler);
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
         return static_cast<int>(error);
     }
     HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
-    if (auto bs = hnsw->get_index()->Serialize(out_stream); bs.has_value()) {
+    ObOpRecorder recorder(hnsw->get_stats(), SERIALIZE_OP, ret);
+    SlowTaskTimer t(SERIALIZE_OP, hnsw, ret);
+    ObSerializeGuard guard(hnsw->get_index_lock());
+    IndexSnapshotPtr snapshot = hnsw->get_snapshot();
+    const TombstoneSnapshot& tombstones = snapshot->tombstones_;
+    vsag::Binary binary;
+    if (tombstones != nullptr) {
+        serialize_tombstones(tombstones, binary);
+    }
+    char header[INDEX_STREAM_HEADER_SIZE];
+    memcpy(header, INDEX_STREAM_MAGIC, sizeof(INDEX_STREAM_MAGIC));
+    put_le(header + sizeof(INDEX_STREAM_MAGIC), INDEX_STREAM_VERSION, sizeof(uint32_t));
+    put_le(header + sizeof(INDEX_STREAM_MAGIC) + sizeof(uint32_t), binary.size, sizeof(uint64_t));
+    out_stream.write(header, sizeof(header));
+    if (binary.size > 0) {
+        out_stream.write(reinterpret_cast<const char*>(binary.data.get()), binary.size);
+    }
+    if (!out_stream.good()) {
+        vsag::logger::error("   write tombstones error happend");
+        ret = static_cast<int>(vsag::ErrorType::INTERNAL_ERROR);
+        return ret;
+    }
+    if (auto bs = snapshot->index_->Serialize(out_stream); bs.has_value()) {
         return 0;
     } else {
         error = bs.error().type;
@@ -703,14 +3886,16 @@ int fserialize(VectorIndexPtr& index_handler, std::ostream& out_stream) {
 }
 
 int fdeserialize(VectorIndexPtr& index_handler, std::istream& in_stream) {
-    vsag::logger::debug("TRACE LOG[fdeserialize]:");
+    OB_VSAG_LOG_DEBUG("TRACE LOG[fdeserialize]:");
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
     int ret = 0;
     if (index_handler == nullptr) {
-        vsag::logger::debug("   null pointer addr, index_handler:{}", (void*)index_handler);
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
         return static_cast<int>(error);
     }
     HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    ObOpRecorder recorder(hnsw->get_stats(), DESERIALIZE_OP, ret);
+    SlowTaskTimer t(DESERIALIZE_OP, hnsw, ret);
     std::shared_ptr<vsag::Index> hnsw_index;
     bool use_static = hnsw->get_use_static();
     const char *metric = hnsw->get_metric();
@@ -721,46 +3906,21 @@ int fdeserialize(VectorIndexPtr& index_handler, std::istream& in_stream) {
     int dim = hnsw->get_dim();
     int index_type = hnsw->get_index_type();
     uint64_t extra_info_size = hnsw->get_extra_info_size();
-    const char *base_quantization_type = (index_type == HNSW_SQ_TYPE) ? "sq8" : ((index_type == HNSW_BQ_TYPE) ? "rabitq" : "fp32");
-    nlohmann::json index_parameters;
-    if (HNSW_TYPE == index_type) {
-        nlohmann::json hnsw_parameters{{"max_degree", max_degree},
-                                    {"ef_construction", ef_construction},
-                                    {"ef_search", ef_search},
-                                    {"use_static", use_static}};
-        index_parameters = {{"dtype", dtype}, {"metric_type", metric}, {"dim", dim}, {"hnsw", hnsw_parameters}};
-    } else if (HNSW_SQ_TYPE == index_type) {
-        nlohmann::json hnswsq_parameters{{"base_quantization_type", base_quantization_type},
-                                        {"max_degree", max_degree},
-                                        {"ef_construction", ef_construction},
-                                        {"build_thread_count", 0}};
-        index_parameters = {{"dtype", dtype}, {"metric_type", metric}, {"dim", dim}, {"extra_info_size", extra_info_size}, {"index_param", hnswsq_parameters}};
-    } else if (HNSW_BQ_TYPE == index_type) {
-        nlohmann::json hnswbq_parameters{{"base_quantization_type", "rabitq"}, 
-                                            {"max_degree", max_degree}, 
-                                            {"ef_construction", ef_construction},
-                                            {"build_thread_count", 0},
-                                            {"use_reorder", true},
-                                            {"ignore_reorder", true},
-                                            {"precise_quantization_type", "fp32"},
-                                            {"precise_io_type", "block_memory_io"}};  
-        index_parameters = {{"dtype", dtype}, {"metric_type", metric}, {"dim", dim}, {"extra_info_size", extra_info_size}, {"index_param", hnswbq_parameters}};
-    } else if (HGRAPH_TYPE == index_type) {
-        nlohmann::json hnswsq_parameters{{"base_quantization_type", base_quantization_type},
-                                        {"max_degree", max_degree},
-                                        {"ef_construction", ef_construction},
-                                        {"build_thread_count", 0}};
-        index_parameters = {{"dtype", dtype}, {"metric_type", metric}, {"dim", dim}, {"extra_info_size", extra_info_size}, {"index_param", hnswsq_parameters}};       
-    }
-
-    vsag::logger::debug("   Deserilize hnsw index , index parameter:{}, allocator addr:{}",index_parameters.dump(),(void*)hnsw->get_allocator());
+    int build_thread_count = hnsw->get_build_thread_count();
+    nlohmann::json index_parameters = make_index_parameters(static_cast<IndexType>(index_type), dtype, metric, dim,
+                                                            max_degree, ef_construction, ef_search, use_static,
+                                                            extra_info_size, build_thread_count, hnsw->get_tenant_id(),
+                                                            hnsw->get_precise_file_path());
+
+    OB_VSAG_LOG_DEBUG("   Deserilize hnsw index , index parameter:{}, allocator addr:{}",index_parameters.dump(),(void*)hnsw->get_allocator());
     if (index_type == HNSW_TYPE) {
         if (auto index = vsag::Factory::CreateIndex("hnsw", index_parameters.dump(), hnsw->get_allocator());
             index.has_value()) {
             hnsw_index = index.value();
         } else {
             error = index.error().type;
-            return static_cast<int>(error);
+            ret = static_cast<int>(error);
+            return ret;
         }
     } else {
         if (auto index = vsag::Factory::CreateIndex("hgraph", index_parameters.dump(), hnsw->get_allocator());
@@ -768,13 +3928,21 @@ int fdeserialize(VectorIndexPtr& index_handler, std::istream& in_stream) {
             hnsw_index = index.value();
         } else {
             error = index.error().type;
-            return static_cast<int>(error);
+            ret = static_cast<int>(error);
+            return ret;
         }        
     }
-    if (ret != 0) {
-
-    } else if (auto bs = hnsw_index->Deserialize(in_stream); bs.has_value()) {
-        hnsw->set_index(hnsw_index);
+    TombstoneSnapshot tombstones;
+    std::string consumed;
+    if ((ret = read_stream_header(in_stream, tombstones, consumed)) != 0) {
+        return ret;
+    }
+    ObPrefixStreambuf prefix_buf(consumed, in_stream.rdbuf());
+    std::istream prefix_stream(&prefix_buf);
+    std::istream& index_stream = consumed.empty() ? in_stream : prefix_stream;
+    if (auto bs = hnsw_index->Deserialize(index_stream); bs.has_value()) {
+        hnsw->load_index(hnsw_index, tombstones);
+        hnsw->set_index_build_thread_count(clamp_build_thread_count(hnsw->get_tenant_id(), build_thread_count));
         return 0;
     } else {
         error = bs.error().type;
@@ -786,15 +3954,9 @@ int fdeserialize(VectorIndexPtr& index_handler, std::istream& in_stream) {
     return ret;
 }
 
-int deserialize_bin(VectorIndexPtr& index_handler,const std::string dir) {
-    vsag::logger::debug("TRACE LOG[deserialize]:");
-    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+static int load_legacy_binary_set(const std::string& dir, bool use_mmap, int64_t tenant_id, vsag::BinarySet& bs)
+{
     int ret = 0;
-    if (index_handler == nullptr) {
-        vsag::logger::debug("   null pointer addr, index_handler={}", (void*)index_handler);
-        return static_cast<int>(error);
-    }
-    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
     std::ifstream metafile(dir + "hnsw.index._meta", std::ios::in);
     std::vector<std::string> keys;
     std::string line;
@@ -803,16 +3965,99 @@ int deserialize_bin(VectorIndexPtr& index_handler,const std::string dir) {
     }
     metafile.close();
 
+    // one file per key, read them in parallel and add them to bs in order, vsag decodes bs serially
+    std::vector<vsag::Binary> binaries(keys.size());
+    std::atomic<int> first_error(0);
+    ObTaskScheduler& scheduler = ObTaskScheduler::instance();
+    scheduler.parallel_for(tenant_id, keys.size(), scheduler.get_max_threads(), [&](int64_t i) {
+        vsag::Binary& b = binaries[i];
+        if (use_mmap) {
+            int map_ret = map_binary(dir + "hnsw.index." + keys[i], b);
+            if (map_ret != 0) {
+                vsag::logger::error("   map index file error happend, key={}, ret={}", keys[i], map_ret);
+                int expected = 0;
+                first_error.compare_exchange_strong(expected, map_ret);
+            }
+        } else {
+            std::ifstream file(dir + "hnsw.index." + keys[i], std::ios::in);
+            file.seekg(0, std::ios::end);
+            b.size = file.tellg();
+            b.data.reset(new int8_t[b.size]);
+            file.seekg(0, std::ios::beg);
+            file.read((char*)b.data.get(), b.size);
+        }
+    });
+    if ((ret = first_error.load()) != 0) {
+        return ret;
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        bs.Set(keys[i], binaries[i]);
+    }
+    return ret;
+}
+
+// mapped sections are read by vsag through readers on the mappings, types that cannot
+// load from a ReaderSet load from the binaries pointing into them
+static int deserialize_binary_set(const std::shared_ptr<vsag::Index>& index, const vsag::BinarySet& bs, bool use_mmap)
+{
+    if (use_mmap) {
+        vsag::ReaderSet reader_set;
+        for (const std::string& key : bs.GetKeys()) {
+            reader_set.Set(key, std::make_shared<ObBinaryReader>(bs.Get(key)));
+        }
+        auto result = index->Deserialize(reader_set);
+        if (result.has_value()) {
+            return 0;
+        } else if (result.error().type != vsag::ErrorType::UNSUPPORTED_INDEX_OPERATION) {
+            return static_cast<int>(result.error().type);
+        }
+        OB_VSAG_LOG_DEBUG("   index does not load from readers, load from the mapped binaries");
+    }
+    if (auto result = index->Deserialize(bs); !result.has_value()) {
+        return static_cast<int>(result.error().type);
+    }
+    return 0;
+}
+
+int deserialize_bin(VectorIndexPtr& index_handler,const std::string dir, bool use_mmap/* = false*/) {
+    OB_VSAG_LOG_DEBUG("TRACE LOG[deserialize]:");
+    vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
+    int ret = 0;
+    if (index_handler == nullptr) {
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler={}", (void*)index_handler);
+        return static_cast<int>(error);
+    }
+    HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler);
+    ObOpRecorder recorder(hnsw->get_stats(), DESERIALIZE_OP, ret);
+    SlowTaskTimer t(DESERIALIZE_OP, hnsw, ret);
     vsag::BinarySet bs;
-    for (auto key : keys) {
-        std::ifstream file(dir + "hnsw.index." + key, std::ios::in);
-        file.seekg(0, std::ios::end);
-        vsag::Binary b;
-        b.size = file.tellg();
-        b.data.reset(new int8_t[b.size]);
-        file.seekg(0, std::ios::beg);
-        file.read((char*)b.data.get(), b.size);
-        bs.Set(key, b);
+    TombstoneSnapshot tombstones;
+    if (ObIndexFile::exists(dir + "hnsw.index")) {
+        ObIndexFile index_file;
+        if ((ret = index_file.open(dir + "hnsw.index")) != 0) {
+            vsag::logger::error("   open index file error happend, ret={}", ret);
+            return ret;
+        }
+        std::vector<vsag::Binary> binaries;
+        if ((ret = index_file.read_sections(use_mmap, hnsw->get_tenant_id(), binaries)) != 0) {
+            vsag::logger::error("   read index file error happend, ret={}", ret);
+            return ret;
+        }
+        for (size_t i = 0; i < binaries.size(); ++i) {
+            const std::string& key = index_file.get_sections()[i].key_;
+            if (key != TOMBSTONE_SECTION_KEY) {
+                bs.Set(key, binaries[i]);
+            } else if ((ret = deserialize_tombstones(reinterpret_cast<const char*>(binaries[i].data.get()),
+                                                     binaries[i].size, tombstones)) != 0) {
+                return ret;
+            }
+        }
+    } else {
+        // files written by serialize before the single file format, one file per key
+        ret = load_legacy_binary_set(dir, use_mmap, hnsw->get_tenant_id(), bs);
+        if (ret != 0) {
+            return ret;
+        }
     }
     bool use_static = hnsw->get_use_static();
     const char *metric = hnsw->get_metric();
@@ -823,35 +4068,13 @@ int deserialize_bin(VectorIndexPtr& index_handler,const std::string dir) {
     int dim = hnsw->get_dim();
     int index_type = hnsw->get_index_type();
     uint64_t extra_info_size = hnsw->get_extra_info_size();
-    const char *base_quantization_type = (index_type == HNSW_SQ_TYPE) ? "sq8" : ((index_type == HNSW_BQ_TYPE) ? "rabitq" : "fp32");
-    nlohmann::json index_parameters;
-    if (index_type == HNSW_TYPE) {
-        nlohmann::json hnsw_parameters{{"max_degree", max_degree},
-                                    {"ef_construction", ef_construction},
-                                    {"ef_search", ef_search},
-                                    {"use_static", use_static}};
-        index_parameters = {{"dtype", dtype}, {"metric_type", metric}, {"dim", dim}, {"hnsw", hnsw_parameters}};
-     } else if (index_type == HNSW_BQ_TYPE) {
-        nlohmann::json hnswbq_parameters{{"base_quantization_type", base_quantization_type}, 
-                                            {"max_degree", max_degree}, 
-                                            {"ef_construction", ef_construction},
-                                            {"build_thread_count", 0},
-                                            {"extra_info_size", extra_info_size},
-                                            {"use_reorder", true},
-                                            {"ignore_reorder", true},
-                                            {"precise_quantization_type", "fp32"},
-                                            {"precise_io_type", "block_memory_io"}};
-        index_parameters = {{"dtype", dtype}, {"metric_type", metric}, {"dim", dim}, {"index_param", hnswbq_parameters}};
-    } else {
-        nlohmann::json hnswsq_parameters{{"base_quantization_type", base_quantization_type},
-                                            {"max_degree", max_degree}, 
-                                            {"ef_construction", ef_construction},
-                                            {"build_thread_count", 0},
-                                            {"extra_info_size", extra_info_size}};
-        index_parameters = {{"dtype", dtype}, {"metric_type", metric}, {"dim", dim}, {"index_param", hnswsq_parameters}};
-    }
-   
-    vsag::logger::debug("   Deserilize hnsw index , index parameter:{}, allocator addr:{}",index_parameters.dump(),(void*)hnsw->get_allocator());
+    int build_thread_count = hnsw->get_build_thread_count();
+    // same parameters as create_index and fdeserialize
+    nlohmann::json index_parameters = make_index_parameters(static_cast<IndexType>(index_type), dtype, metric, dim,
+                                                            max_degree, ef_construction, ef_search, use_static,
+                                                            extra_info_size, build_thread_count, hnsw->get_tenant_id(),
+                                                            hnsw->get_precise_file_path());
+    OB_VSAG_LOG_DEBUG("   Deserilize hnsw index , index parameter:{}, allocator addr:{}",index_parameters.dump(),(void*)hnsw->get_allocator());
     std::shared_ptr<vsag::Index> hnsw_index;
     if (index_type == HNSW_TYPE) {
         if (auto index = vsag::Factory::CreateIndex("hnsw", index_parameters.dump(), hnsw->get_allocator());
@@ -859,7 +4082,8 @@ int deserialize_bin(VectorIndexPtr& index_handler,const std::string dir) {
             hnsw_index = index.value();
         } else {
             error = index.error().type;
-            return static_cast<int>(error);
+            ret = static_cast<int>(error);
+            return ret;
         }
     } else {
         if (auto index = vsag::Factory::CreateIndex("hgraph", index_parameters.dump(), hnsw->get_allocator());
@@ -867,17 +4091,22 @@ int deserialize_bin(VectorIndexPtr& index_handler,const std::string dir) {
             hnsw_index = index.value();
         } else {
             error = index.error().type;
-            return static_cast<int>(error);
+            ret = static_cast<int>(error);
+            return ret;
         }        
     }
-    hnsw_index->Deserialize(bs);
-    hnsw->set_index(hnsw_index);
+    if ((ret = deserialize_binary_set(hnsw_index, bs, use_mmap)) != 0) {
+        vsag::logger::error("   deserialize error happend, ret={}", ret);
+        return ret;
+    }
+    hnsw->load_index(hnsw_index, tombstones);
+    hnsw->set_index_build_thread_count(clamp_build_thread_count(hnsw->get_tenant_id(), build_thread_count));
     return 0;
 }
 
 int delete_index(VectorIndexPtr& index_handler) {
-    vsag::logger::debug("TRACE LOG[delete_index]");
-    vsag::logger::debug("   delete index handler addr {} : hnsw index use count {}",(void*)static_cast<HnswIndexHandler*>(index_handler)->get_index().get(),static_cast<HnswIndexHandler*>(index_handler)->get_index().use_count());
+    OB_VSAG_LOG_DEBUG("TRACE LOG[delete_index]");
+    OB_VSAG_LOG_DEBUG("   delete index handler addr {} : hnsw index use count {}",(void*)static_cast<HnswIndexHandler*>(index_handler)->get_index().get(),static_cast<HnswIndexHandler*>(index_handler)->get_index().use_count());
     if (index_handler != NULL) {
         delete static_cast<HnswIndexHandler*>(index_handler);
         index_handler = NULL;
@@ -886,7 +4115,7 @@ int delete_index(VectorIndexPtr& index_handler) {
 }
 
 void delete_iter_ctx(void *iter_ctx) {
-    vsag::logger::debug("TRACE LOG[delete_iter_ctx]");
+    OB_VSAG_LOG_DEBUG("TRACE LOG[delete_iter_ctx]");
     if (iter_ctx != NULL) {
         delete static_cast<vsag::IteratorContext*>(iter_ctx);
         iter_ctx = NULL;
@@ -899,7 +4128,7 @@ int get_extra_info_by_ids(VectorIndexPtr& index_handler,
                           char *extra_infos) {
     vsag::ErrorType error = vsag::ErrorType::UNKNOWN_ERROR;
     if (index_handler == nullptr) {
-        vsag::logger::debug("   null pointer addr, index_handler:{}", (void*)index_handler);
+        OB_VSAG_LOG_DEBUG("   null pointer addr, index_handler:{}", (void*)index_handler);
         return static_cast<int>(error);
     }
     HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler); 
@@ -912,7 +4141,7 @@ int get_extra_info_by_ids(VectorIndexPtr& index_handler,
 
 uint64_t estimate_memory(VectorIndexPtr& index_handler,
                          uint64_t row_count) {
-    vsag::logger::debug("TRACE LOG[estimate_memory]");
+    OB_VSAG_LOG_DEBUG("TRACE LOG[estimate_memory]");
     uint64_t estimate_memory_size = 0;
     if (index_handler != nullptr) {
         HnswIndexHandler* hnsw = static_cast<HnswIndexHandler*>(index_handler); 
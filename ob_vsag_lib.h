@@ -8,6 +8,7 @@ namespace obvectorlib {
 
 int64_t example();
 typedef void* VectorIndexPtr;
+typedef void* SearchPlanPtr;
 extern bool is_init_;
 enum IndexType {
   INVALID_INDEX_TYPE = -1,
@@ -22,10 +23,149 @@ enum IndexType {
   MAX_INDEX_TYPE
 };
 
+/*
+ * Element type of the vectors given to the typed entry points. FLOAT16_VECTOR and
+ * BFLOAT16_VECTOR rows are widened to fp32 for vsag, create_index with dtype
+ * "float16"/"bfloat16" keeps the vectors of HGRAPH_TYPE and the reorder vectors of
+ * HNSW_BQ_TYPE at that precision. Other index types cannot store them and create_index
+ * rejects these dtypes for them with INVALID_ARGUMENT.
+ * INT8_VECTOR rows and queries are given to vsag as int8, only by build_index, add_index,
+ * knn_search and knn_search_into, and only to a HNSW_TYPE index created with dtype "int8"
+ * (vsag supports it for the "ip" metric). Such an index takes no other vector type, no
+ * ingest stage and no fp32 entry point (exact search, recall checks, distances by id),
+ * any other index rejects INT8_VECTOR, all with INVALID_ARGUMENT.
+ */
+enum VectorDataType {
+  FLOAT32_VECTOR = 0,
+  FLOAT16_VECTOR = 1,
+  BFLOAT16_VECTOR = 2,
+  INT8_VECTOR = 3
+};
+
+// ingest stage of build_index/add_index, see set_ingest_options
+enum IngestFlag {
+  INGEST_VALIDATE = 1,  // drop rows holding NaN or Inf
+  INGEST_NORMALIZE = 2  // scale rows to unit l2 norm, drop the rows that cannot be scaled
+};
+
+enum FilterType {
+  CALLBACK_FILTER_TYPE = 0,
+  ROARING_FILTER_TYPE = 1,
+  BITSET_FILTER_TYPE = 2
+};
+
 class FilterInterface {
 public:
   virtual bool test(int64_t id) = 0;
   virtual bool test(const char* data) = 0;
+  // filters other than CALLBACK_FILTER_TYPE are checked natively during search, test() is not called
+  virtual FilterType get_filter_type() const { return CALLBACK_FILTER_TYPE; }
+  // out[i] = test(ids[i]), override to check a group of rows at once
+  virtual void test_batch(const int64_t* ids, int n, uint8_t* out) {
+    for (int i = 0; i < n; ++i) {
+      out[i] = test(ids[i]);
+    }
+  }
+  // out[i] = test(datas[i]) on extra infos
+  virtual void test_batch(const char* const* datas, int n, uint8_t* out) {
+    for (int i = 0; i < n; ++i) {
+      out[i] = test(datas[i]);
+    }
+  }
+  /*
+   * When > 1 (at most 64), an id visited by search is checked together with the other
+   * ids of its aligned block of batch_size() consecutive ids through test_batch, and
+   * the result of the block is reused by later visits in the same search.
+   */
+  virtual int batch_size() const { return 0; }
+};
+
+/*
+ * Id filter on a roaring64_bitmap_t, ids in the bitmap are filtered out
+ * (or are the only ones kept when reverse_filter is set).
+ */
+class RoaringFilter : public FilterInterface {
+public:
+  explicit RoaringFilter(void* roaring64_bitmap) : bitmap_(roaring64_bitmap) {}
+  bool test(int64_t id) override;
+  bool test(const char* /*data*/) override { return false; }
+  FilterType get_filter_type() const override { return ROARING_FILTER_TYPE; }
+  void* get_bitmap() const { return bitmap_; }
+private:
+  void* bitmap_;
+};
+
+/*
+ * Id filter on a dense bitset over [min_vid, max_vid] (see get_vid_bound), bit
+ * (id - min_vid) of words set means id is filtered out (or kept when reverse_filter
+ * is set), ids out of the range are never filtered out.
+ */
+class BitsetFilter : public FilterInterface {
+public:
+  BitsetFilter(const uint64_t* words, int64_t min_vid, int64_t max_vid)
+    : words_(words), min_vid_(min_vid), max_vid_(max_vid) {}
+  bool test(int64_t id) override { return contains(id); }
+  bool test(const char* /*data*/) override { return false; }
+  FilterType get_filter_type() const override { return BITSET_FILTER_TYPE; }
+  inline bool contains(int64_t id) const {
+    if (id < min_vid_ || id > max_vid_) {
+      return false;
+    }
+    uint64_t offset = static_cast<uint64_t>(id - min_vid_);
+    return (words_[offset >> 6] >> (offset & 63)) & 1;
+  }
+  const uint64_t* get_words() const { return words_; }
+  int64_t get_min_vid() const { return min_vid_; }
+  int64_t get_max_vid() const { return max_vid_; }
+private:
+  const uint64_t* words_;
+  int64_t min_vid_;
+  int64_t max_vid_;
+};
+enum IndexOpType {
+  SEARCH_OP = 0,
+  SEARCH_BATCH_OP = 1,
+  BUILD_OP = 2,
+  ADD_OP = 3,
+  UPDATE_OP = 4,
+  REMOVE_OP = 5,
+  SERIALIZE_OP = 6,
+  DESERIALIZE_OP = 7,
+  MAX_OP
+};
+
+static const int LATENCY_BUCKET_NUM = 32;
+
+/*
+ * Counters of one index handler since it was created, see get_index_stats.
+ * latency_buckets_[op][0] counts calls shorter than 1us, latency_buckets_[op][i] calls
+ * of [2^(i-1), 2^i) us, the last bucket also counts all longer calls.
+ */
+struct IndexStats {
+  int64_t op_count_[MAX_OP];
+  int64_t op_fail_count_[MAX_OP];
+  int64_t op_time_us_[MAX_OP];
+  int64_t latency_buckets_[MAX_OP][LATENCY_BUCKET_NUM];
+  int64_t query_count_;           // queries of all knn searches, a batch counts its queries
+  int64_t filtered_query_count_;  // queries with a filter
+  int64_t result_row_count_;      // rows returned by all queries
+  int64_t write_row_count_;       // rows built, added, updated or removed
+  int64_t distance_count_;        // distances computed by cal_distance_by_id
+  int64_t recall_check_count_;    // searches checked by the recall monitor, see set_recall_monitor
+  int64_t recall_hit_count_;      // exact topk rows returned by the checked searches
+  int64_t recall_expected_count_; // exact topk rows of the checked searches
+  int64_t rejected_row_count_;    // rows dropped by the ingest stage, see set_ingest_options
+};
+
+/*
+ * Executor running the parallel and background tasks of the library on threads managed
+ * by the caller. execute() returns 0 when func(arg) is scheduled, otherwise the library
+ * runs the task itself.
+ */
+class TaskExecutor {
+public:
+  virtual ~TaskExecutor() {}
+  virtual int execute(void (*func)(void* arg), void* arg) = 0;
 };
 /**
  *   * Get the version based on git revision
@@ -52,19 +192,122 @@ extern bool is_init();
  * *off = 6
  * */
 extern void set_log_level(int32_t ob_level_num);
+/* logger_ptr is a vsag::Logger, it logs at the level of the last set_log_level (info before any) */
 extern void set_logger(void *logger_ptr);
+/*
+ * Log calls of op taking at least threshold_us through the installed logger at warn level,
+ * with the index type, element count, row count and for searches topk, ef_search, filter
+ * and valid_ratio. Only one of every sample_interval slow calls is logged.
+ * threshold_us < 0 turns the slow log of op off, which is the default.
+ */
+extern int set_slow_log(IndexOpType op, int64_t threshold_us, int64_t sample_interval = 1);
 extern void set_block_size_limit(uint64_t size);
 extern bool is_supported_index(IndexType index_type);
+/*
+ * Builds, batched searches and background tasks of all index handlers run on one
+ * process wide scheduler. set_thread_pool installs a caller executor (NULL restores
+ * the built-in work stealing pool), set_max_threads bounds the threads working at
+ * the same time (0 runs parallel work on the calling threads), set_tenant_thread_quota
+ * bounds the threads used by the indexes of a tenant (-1 removes the quota) and
+ * set_index_tenant assigns an index to a tenant. Background tasks (tombstone repair,
+ * recall checks, ef_search calibration) are charged to both limits, wait for a free
+ * thread and are skipped while a limit is 0, they never run on the calling thread.
+ */
+extern void set_thread_pool(TaskExecutor* executor);
+extern void set_max_threads(int thread_num);
+extern void set_tenant_thread_quota(int64_t tenant_id, int max_threads);
+extern int set_index_tenant(VectorIndexPtr& index_handler, int64_t tenant_id);
+/*
+ * Precise vector file of HNSW_BQ_TYPE: the next deserialize_bin/fdeserialize keeps the
+ * graph and the rabitq codes in memory and writes the fp32 vectors used by reorder to
+ * file_path, reorder reads them back through the page cache. This is not lazy loading:
+ * the load still reads every vector and writes a second copy of them to disk, it only
+ * saves the memory of the vectors. file_path must be unique per index and is owned by
+ * the caller, NULL or "" goes back to keeping everything in memory.
+ */
+extern int set_precise_vector_file(VectorIndexPtr& index_handler, const char* file_path);
 extern int create_index(VectorIndexPtr& index_handler, IndexType index_type,
                         const char* dtype,
                         const char* metric,int dim,
                         int max_degree, int ef_construction, int ef_search, void* allocator = NULL,
-                        int extra_info_size = 0);
-extern int build_index(VectorIndexPtr& index_handler, float* vector_list, int64_t* ids, int dim, int size, char *extra_infos = nullptr);
+                        int extra_info_size = 0, int build_thread_count = 0);
+/*
+ * build_thread_count: threads used to build the index, 0 keeps vsag default, -1 keeps
+ * the value given to create_index. For HNSW_TYPE (not static, fp32 rows without extra
+ * info) the rows are inserted in blocks by build_thread_count threads, the hgraph types
+ * recreate the still empty index with it, anything else builds on the calling thread.
+ * The hgraph types start these threads themselves, so the value they are created with
+ * is capped by set_max_threads and the quota of the tenant of the index (see above).
+ */
+extern int build_index(VectorIndexPtr& index_handler, float* vector_list, int64_t* ids, int dim, int size, char *extra_infos = nullptr,
+                       int build_thread_count = -1);
+/*
+ * Concurrency of one index handler: any number of threads may search, add, update,
+ * remove and serialize at the same time.
+ * - A row is visible to every search started after the add_index/update_index that
+ *   wrote it returned. A search running during the call sees the rows in chunks of
+ *   256, never a partially inserted row.
+ * - HNSW_TYPE inserts run concurrently with searches and each other. Other types insert
+ *   one chunk at a time with searches paused, which bounds the search latency added by
+ *   a large batch to the time of one chunk.
+ * - serialize/fserialize keep searches running, writes wait until the index is written.
+ */
 extern int add_index(VectorIndexPtr& index_handler, float* vector, int64_t* ids, int dim, int size, char *extra_info = nullptr);
+/*
+ * build_index/add_index of vector_type rows. build_index converts the rows and builds the
+ * index from them in one piece when their fp32 copy fits in 1GB. A larger input is built
+ * from 64K rows sampled across all of it, quantizers of HNSW_SQ_TYPE/HNSW_BQ_TYPE are
+ * trained on them, and the other rows are converted and added 64K at a time. add_index
+ * converts and inserts its rows in blocks. rejected_count, when not NULL,
+ * is set to the rows of the call dropped by the ingest stage.
+ */
+extern int build_index(VectorIndexPtr& index_handler, const void* vector_list, VectorDataType vector_type,
+                       int64_t* ids, int dim, int size, char *extra_infos = nullptr, int build_thread_count = -1,
+                       int64_t* rejected_count = nullptr);
+extern int add_index(VectorIndexPtr& index_handler, const void* vector, VectorDataType vector_type,
+                     int64_t* ids, int dim, int size, char *extra_info = nullptr, int64_t* rejected_count = nullptr);
+/*
+ * Ingest stage of the rows written by build_index/add_index, flags is a mask of IngestFlag
+ * (0 turns it off). Rows are copied to fp32 and checked or normalized in parallel blocks on
+ * the build threads before insertion, the caller buffers are left unchanged. build_index
+ * then builds like the typed build_index. Dropped rows
+ * are not inserted, they are counted in rejected_row_count_ of get_index_stats.
+ * update_index runs the same stage on its rows: they are all checked first and a row
+ * that would be dropped fails the call with INVALID_ARGUMENT, leaving every row unchanged.
+ * INGEST_NORMALIZE is an invalid argument unless the metric is "cosine", scaling a row
+ * changes its "l2" and "ip" distances.
+ */
+extern int set_ingest_options(VectorIndexPtr& index_handler, int flags);
+/*
+ * Replace the vectors of existing rows in place. A row whose new vector stays close to
+ * its old neighborhood only has that neighborhood repaired, other rows are relinked
+ * like a new insert. Rows after the first failing one are left unchanged. vsag cannot
+ * replace extra infos in place: with a non NULL extra_info the rows are removed like
+ * remove_index and added again with their new vectors and extra infos, searches miss
+ * them between the two steps and a failing add leaves them removed.
+ */
+extern int update_index(VectorIndexPtr& index_handler, float* vector, int64_t* ids, int dim, int size, char *extra_info = nullptr);
+/*
+ * Remove count rows by id. The rows are masked from every search right away, then a
+ * background task on the task scheduler removes them from the index, which unlinks
+ * them from the graph and reconnects their neighbors. Rows the index type cannot
+ * remove stay masked, the mask is saved and loaded with the index. Adding a removed
+ * id again makes it visible again. Searches filtering on extra infos see masked rows
+ * and search again for more rows when they drop some, a page of an iterator search
+ * is returned short instead.
+ */
+extern int remove_index(VectorIndexPtr& index_handler, const int64_t* ids, int64_t count);
 extern int get_index_number(VectorIndexPtr& index_handler, int64_t &size);
+/*
+ * Copy the counters of index_handler into stats. The counters are updated without locks,
+ * a copy taken during concurrent calls may be off by the calls in flight. Graph hops and
+ * distances computed inside vsag searches are not reported by vsag and not counted.
+ */
+extern int get_index_stats(VectorIndexPtr& index_handler, IndexStats& stats);
 extern int get_index_type(VectorIndexPtr& index_handler);
 extern int cal_distance_by_id(VectorIndexPtr& index_handler, const float* vector, const int64_t* ids, int64_t count, const float *&distances);
+extern int cal_distance_by_id(VectorIndexPtr& index_handler, const void* vector, VectorDataType vector_type,
+                              const int64_t* ids, int64_t count, const float *&distances);
 extern int get_vid_bound(VectorIndexPtr& index_handler, int64_t &min_vid, int64_t &max_vid);
 extern int knn_search(VectorIndexPtr& index_handler,float* query_vector, int dim, int64_t topk,
                       const float*& dist, const int64_t*& ids, int64_t &result_size, int ef_search,
@@ -76,10 +319,161 @@ extern int knn_search(VectorIndexPtr& index_handler,float* query_vector, int dim
                       bool need_extra_info, const char*& extra_infos,
                       void* invalid = NULL, bool reverse_filter = false,
                       bool use_extra_info_filter = false, float valid_ratio = 1);
+/*
+ * Same as knn_search, but results are copied into caller owned buffers holding
+ * at least topk rows (extra_infos: topk * extra_info_size bytes, only used when
+ * need_extra_info is set), so there is nothing to free after the call and the
+ * buffers can be reused by the next query.
+ */
+extern int knn_search_into(VectorIndexPtr& index_handler, float* query_vector, int dim, int64_t topk,
+                           float* dist, int64_t* ids, int64_t &result_size, int ef_search,
+                           bool need_extra_info, char* extra_infos,
+                           void* invalid = NULL, bool reverse_filter = false,
+                           bool use_extra_info_filter = false, float valid_ratio = 1);
+/* knn_search/knn_search_into of a vector_type query */
+extern int knn_search(VectorIndexPtr& index_handler, const void* query_vector, VectorDataType vector_type,
+                      int dim, int64_t topk,
+                      const float*& dist, const int64_t*& ids, int64_t &result_size, int ef_search,
+                      bool need_extra_info, const char*& extra_infos,
+                      void* invalid = NULL, bool reverse_filter = false,
+                      bool use_extra_info_filter = false, float valid_ratio = 1);
+extern int knn_search_into(VectorIndexPtr& index_handler, const void* query_vector, VectorDataType vector_type,
+                           int dim, int64_t topk,
+                           float* dist, int64_t* ids, int64_t &result_size, int ef_search,
+                           bool need_extra_info, char* extra_infos,
+                           void* invalid = NULL, bool reverse_filter = false,
+                           bool use_extra_info_filter = false, float valid_ratio = 1);
+/*
+ * Rows at a distance <= radius of query_vector (distances as returned by knn_search, e.g.
+ * squared l2), at most limit of them by ascending distance, written into the caller
+ * allocated dist/ids (and extra_infos, extra_info_size bytes per row) of limit rows.
+ * ef_search <= 0 uses the ef_search of create_index. Filters behave as in knn_search.
+ */
+extern int range_search(VectorIndexPtr& index_handler, float* query_vector, int dim, float radius, int64_t limit,
+                        float* dist, int64_t* ids, int64_t &result_size, int ef_search,
+                        bool need_extra_info, char* extra_infos,
+                        void* invalid = NULL, bool reverse_filter = false,
+                        bool use_extra_info_filter = false, float valid_ratio = 1);
+/*
+ * Search query_count queries (row-major, query_count * dim floats) in one call,
+ * query_count <= 0 is an invalid argument. topks/ef_searches hold one value per query. Results of query i are written
+ * into the caller allocated dists/ids (and extra_infos, extra_info_size bytes per
+ * row) starting at offset topks[0] + ... + topks[i-1], result_sizes[i] holds the
+ * number of rows found for query i, 0 for the queries not run when an error is returned.
+ * filters: NULL or filter_count == 0 means no filter, filter_count == 1 shares
+ * filters[0] by all queries, filter_count == query_count gives one filter per query.
+ * thread_num: number of threads used to run the queries, <= 1 means serial.
+ */
+extern int knn_search_batch(VectorIndexPtr& index_handler, const float* query_vectors, int dim,
+                            int64_t query_count, const int64_t* topks, const int* ef_searches,
+                            float* dists, int64_t* ids, int64_t* result_sizes,
+                            bool need_extra_info, char* extra_infos,
+                            void** filters, int64_t filter_count, bool reverse_filter,
+                            bool use_extra_info_filter, float valid_ratio, int thread_num);
+/*
+ * Get the search plan of (ef_search, use_extra_info_filter, skip_ratio), skip_ratio
+ * only takes effect on HNSW_TYPE. The plan is cached on the index handler and stays
+ * valid until delete_index, pass it to knn_search_with_plan to skip building the
+ * search parameters on every query.
+ */
+extern int get_search_plan(VectorIndexPtr& index_handler, int ef_search, bool use_extra_info_filter,
+                           float skip_ratio, SearchPlanPtr& search_plan);
+extern int knn_search_with_plan(VectorIndexPtr& index_handler, SearchPlanPtr search_plan,
+                                float* query_vector, int dim, int64_t topk,
+                                const float*& dist, const int64_t*& ids, int64_t &result_size,
+                                bool need_extra_info, const char*& extra_infos,
+                                void* invalid = NULL, bool reverse_filter = false, float valid_ratio = 1);
+/*
+ * Exact topk of query_count queries (row-major, query_count * dim floats) by a full scan,
+ * results of query i are written at offset i * topk of dists/ids by ascending distance
+ * and result_sizes[i] holds their count. invalid/reverse_filter filter rows by id like
+ * knn_search, extra info filters are not supported. thread_num <= 1 means serial.
+ * The first form scans base_count rows of base with ids base_ids (NULL means row numbers)
+ * under metric "l2", "ip" or "cosine", with SIMD kernels. The second form scans the rows
+ * of index_handler over its vid range (see get_vid_bound) through cal_distance_by_id, so
+ * distances are those of the vectors the index keeps, quantized ones for HNSW_SQ/HNSW_BQ.
+ * Counts <= 0, topk < 0 and NULL buffers return INVALID_ARGUMENT, here and in evaluate_recall.
+ */
+extern int exact_search(const float* base, const int64_t* base_ids, int64_t base_count, int dim, const char* metric,
+                        const float* query_vectors, int64_t query_count, int64_t topk,
+                        float* dists, int64_t* ids, int64_t* result_sizes,
+                        void* invalid = NULL, bool reverse_filter = false, int thread_num = 1);
+extern int exact_search(VectorIndexPtr& index_handler, const float* query_vectors, int dim,
+                        int64_t query_count, int64_t topk,
+                        float* dists, int64_t* ids, int64_t* result_sizes,
+                        void* invalid = NULL, bool reverse_filter = false, int thread_num = 1);
+/*
+ * recall = fraction of the exact topk rows of the queries (see exact_search on index_handler)
+ * returned by knn search with ef_search. Meant for spot checks on sampled live queries.
+ */
+extern int evaluate_recall(VectorIndexPtr& index_handler, const float* query_vectors, int dim,
+                           int64_t query_count, int64_t topk, int ef_search, float& recall,
+                           void* invalid = NULL, bool reverse_filter = false, int thread_num = 1);
+/*
+ * Tune ef_search of index_handler for target_recall (0 < target_recall <= 1, <= 0 turns
+ * tuning off). In background, recall@topk of sampled queries is measured against
+ * exact_search for increasing ef_search, right away, whenever a new topk is asked for
+ * and each time the index grew by a tenth through build_index/add_index. Searches given
+ * ef_search <= 0 then run with the smallest ef_search meeting the target for their topk,
+ * and with the ef_search of create_index until the first calibration is done. Live
+ * queries are sampled once tuning is on, written rows stand in for them until then.
+ */
+extern int set_recall_target(VectorIndexPtr& index_handler, float target_recall);
+// ef_search a search of topk with ef_search <= 0 runs with
+extern int get_tuned_ef_search(VectorIndexPtr& index_handler, int64_t topk, int& ef_search);
+/*
+ * Filtered knn_search, knn_search_into and knn_search_with_plan score the rows kept by the
+ * filter one by one instead of walking the graph when at most max_rows (default 2048) or a
+ * fraction of at most max_ratio (default 0.001) of the rows are estimated to be kept. The
+ * estimate is exact for a RoaringFilter, taken from valid_ratio when it is >= 0, and
+ * sampled from the filter when valid_ratio < 0. Extra info filters always use the graph.
+ */
+extern void set_filter_planner(int64_t max_rows, float max_ratio);
+/*
+ * Check one of every sample_interval unfiltered knn searches of index_handler against an
+ * exact search in background, a check below min_recall is logged at warn level and all
+ * checks are counted in IndexStats. sample_interval <= 0 turns the monitor off (default).
+ */
+extern int set_recall_monitor(VectorIndexPtr& index_handler, int64_t sample_interval, float min_recall);
+/*
+ * The exact searches of recall checks and ef_search calibrations compute the distance of
+ * every id of [min_vid, max_vid] (see get_vid_bound) to each query through vsag, which
+ * keeps the only copy of the vectors. One check or calibration computes at most
+ * max_distances of them (default 16M): a recall check is skipped on an index with a
+ * larger vid range, a calibration uses fewer sampled queries and is skipped when not
+ * even one fits.
+ */
+extern void set_recall_check_budget(int64_t max_distances);
 extern int serialize(VectorIndexPtr& index_handler, const std::string dir);
-extern int deserialize_bin(VectorIndexPtr& index_handler, const std::string dir);
+/*
+ * The sections of the index file (the key files of a legacy directory) are read with pread
+ * and CRC checked in parallel on the task scheduler under the tenant of the index. Only
+ * this I/O is parallel: vsag decodes the whole index in one serial Deserialize call.
+ * use_mmap: map the index files read-only instead of reading them into heap buffers and
+ * let vsag read every section through a vsag::Reader on its mapping (Index::Deserialize
+ * of a ReaderSet), types without reader support load from binaries pointing into the
+ * mappings. No heap copy of the file is made, the index vsag builds in memory is still
+ * copied out of the mappings, which are dropped as soon as vsag has loaded the index.
+ */
+extern int deserialize_bin(VectorIndexPtr& index_handler, const std::string dir, bool use_mmap = false);
+/*
+ * fserialize writes a versioned header holding the removed rows not yet repaired, then
+ * the vsag stream. fdeserialize also reads streams holding the vsag stream alone, from
+ * streams that cannot seek too, and leaves the stream at the end of the index.
+ */
 extern int fserialize(VectorIndexPtr& index_handler, std::ostream& out_stream);
 extern int fdeserialize(VectorIndexPtr& index_handler, std::istream& in_stream);
+/*
+ * Searches pin the index they start on, so deserialize_bin/fdeserialize can load an
+ * index while the handler serves queries and publish it when it is complete. To rebuild
+ * in the background, build into a second handler created with the same parameters and
+ * swap_index it in: index_handler serves the new index from the next search on and
+ * new_index_handler holds the old one until it is deleted. Rows removed with remove_index
+ * and ef_search values tuned by set_recall_target move with their index, a load drops the
+ * tuned values. Writes and searches of either handler running at the swap finish first.
+ * Iterator contexts of knn_search started before a swap or load must be deleted, not continued.
+ */
+extern int swap_index(VectorIndexPtr& index_handler, VectorIndexPtr& new_index_handler);
 extern int delete_index(VectorIndexPtr& index_handler);
 extern void delete_iter_ctx(void *iter_ctx);
 extern uint64_t estimate_memory(VectorIndexPtr& index_handler, uint64_t row_count);
@@ -0,0 +1,312 @@
+#include "ob_vsag_thread_pool.h"
+#include "default_logger.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace obvectorlib {
+
+const int64_t ObTaskScheduler::DEFAULT_TENANT_ID;
+const int ObTaskScheduler::MAX_POOL_THREADS;
+
+static thread_local int current_worker_idx = -1;
+
+static void run_heap_task(void* arg)
+{
+    std::function<void()>* task = static_cast<std::function<void()>*>(arg);
+    (*task)();
+    delete task;
+}
+
+ObTaskScheduler& ObTaskScheduler::instance()
+{
+    // never destroyed, pool threads may still be waiting for tasks at process exit
+    static ObTaskScheduler* scheduler = new ObTaskScheduler();
+    return *scheduler;
+}
+
+ObTaskScheduler::ObTaskScheduler()
+    : max_threads_(std::min<int>(std::max<int>(std::thread::hardware_concurrency(), 1), MAX_POOL_THREADS)),
+      started_thread_num_(0),
+      executor_(nullptr),
+      pending_task_num_(0),
+      next_worker_(0),
+      used_threads_(0)
+{}
+
+void ObTaskScheduler::set_max_threads(int thread_num)
+{
+    max_threads_.store(std::min(std::max(thread_num, 0), static_cast<int>(MAX_POOL_THREADS)));
+    vsag::logger::info("   set max threads of task scheduler: {}", max_threads_.load());
+    start_background_tasks();
+}
+
+void ObTaskScheduler::set_executor(TaskExecutor* executor)
+{
+    executor_.store(executor);
+    vsag::logger::info("   set task executor of task scheduler: {}", (void*)executor);
+}
+
+void ObTaskScheduler::set_tenant_quota(int64_t tenant_id, int max_threads)
+{
+    {
+        std::lock_guard<std::mutex> lock(quota_mutex_);
+        if (max_threads < 0) {
+            tenant_quotas_.erase(tenant_id);
+        } else {
+            tenant_quotas_[tenant_id] = max_threads;
+        }
+    }
+    start_background_tasks();
+}
+
+int ObTaskScheduler::get_thread_limit(int64_t tenant_id)
+{
+    std::lock_guard<std::mutex> lock(quota_mutex_);
+    int limit = max_threads_.load();
+    auto quota = tenant_quotas_.find(tenant_id);
+    if (quota != tenant_quotas_.end()) {
+        limit = std::min(limit, quota->second);
+    }
+    return std::max(limit, 1);
+}
+
+int ObTaskScheduler::acquire_threads(int64_t tenant_id, int wanted)
+{
+    std::lock_guard<std::mutex> lock(quota_mutex_);
+    int granted = std::min(wanted, max_threads_.load() - used_threads_);
+    auto quota = tenant_quotas_.find(tenant_id);
+    if (quota != tenant_quotas_.end()) {
+        granted = std::min(granted, quota->second - tenant_used_[tenant_id]);
+    }
+    if (granted <= 0) {
+        return 0;
+    }
+    used_threads_ += granted;
+    tenant_used_[tenant_id] += granted;
+    return granted;
+}
+
+void ObTaskScheduler::release_threads(int64_t tenant_id, int count)
+{
+    if (count <= 0) {
+        return;
+    }
+    bool has_background = false;
+    {
+        std::lock_guard<std::mutex> lock(quota_mutex_);
+        used_threads_ -= count;
+        tenant_used_[tenant_id] -= count;
+        has_background = !background_tasks_.empty();
+    }
+    if (has_background) {
+        start_background_tasks();
+    }
+}
+
+// start the queued background tasks a thread can be acquired for, drop those that can never get one
+void ObTaskScheduler::start_background_tasks()
+{
+    std::vector<std::shared_ptr<BackgroundTask>> ready;
+    std::vector<std::shared_ptr<BackgroundTask>> dropped;
+    {
+        std::lock_guard<std::mutex> lock(quota_mutex_);
+        const int max_threads = max_threads_.load();
+        for (auto it = background_tasks_.begin(); it != background_tasks_.end();) {
+            const int64_t tenant_id = (*it)->tenant_id_;
+            auto quota = tenant_quotas_.find(tenant_id);
+            const int limit = quota == tenant_quotas_.end() ? max_threads : std::min(max_threads, quota->second);
+            if (limit <= 0) {
+                dropped.push_back(*it);
+                it = background_tasks_.erase(it);
+            } else if (used_threads_ < max_threads
+                       && (quota == tenant_quotas_.end() || tenant_used_[tenant_id] < quota->second)) {
+                used_threads_++;
+                tenant_used_[tenant_id]++;
+                ready.push_back(*it);
+                it = background_tasks_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (auto& task : dropped) {
+        task->on_drop_();
+    }
+    for (auto& task : ready) {
+        std::function<void()> run = [this, task]() {
+            task->task_();
+            release_threads(task->tenant_id_, 1);
+        };
+        if (!dispatch(std::move(run))) {
+            // the executor refused it
+            release_threads(task->tenant_id_, 1);
+            task->on_drop_();
+        }
+    }
+}
+
+// hand task over to the executor or the pool, task is left untouched when it cannot be run
+bool ObTaskScheduler::dispatch(std::function<void()>&& task)
+{
+    TaskExecutor* executor = executor_.load();
+    if (executor != nullptr) {
+        std::function<void()>* heap_task = new std::function<void()>(std::move(task));
+        if (0 == executor->execute(&run_heap_task, heap_task)) {
+            return true;
+        }
+        task = std::move(*heap_task);
+        delete heap_task;
+        return false;
+    }
+    int max_threads = max_threads_.load();
+    if (max_threads <= 0) {
+        return false;
+    }
+    ensure_workers(max_threads);
+    int started = started_thread_num_.load();
+    // tasks created by a pool thread stay on its own deque, others spread over the pool
+    int worker_idx = current_worker_idx >= 0 ? current_worker_idx : static_cast<int>(next_worker_++ % started);
+    {
+        std::lock_guard<std::mutex> lock(workers_[worker_idx].mutex_);
+        workers_[worker_idx].tasks_.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex_);
+        pending_task_num_++;
+    }
+    wait_cond_.notify_one();
+    return true;
+}
+
+bool ObTaskScheduler::pop_or_steal(int worker_idx, std::function<void()>& task)
+{
+    {
+        Worker& worker = workers_[worker_idx];
+        std::lock_guard<std::mutex> lock(worker.mutex_);
+        if (!worker.tasks_.empty()) {
+            task = std::move(worker.tasks_.back());
+            worker.tasks_.pop_back();
+            pending_task_num_--;
+            return true;
+        }
+    }
+    int started = started_thread_num_.load();
+    for (int i = 1; i < started; ++i) {
+        Worker& victim = workers_[(worker_idx + i) % started];
+        std::lock_guard<std::mutex> lock(victim.mutex_);
+        if (!victim.tasks_.empty()) {
+            task = std::move(victim.tasks_.front());
+            victim.tasks_.pop_front();
+            pending_task_num_--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ObTaskScheduler::ensure_workers(int thread_num)
+{
+    if (started_thread_num_.load() >= thread_num) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(start_mutex_);
+    for (int i = started_thread_num_.load(); i < thread_num; ++i) {
+        std::thread(&ObTaskScheduler::run_worker, this, i).detach();
+        started_thread_num_.store(i + 1);
+    }
+    OB_VSAG_LOG_DEBUG("   task scheduler started threads: {}", started_thread_num_.load());
+}
+
+void ObTaskScheduler::run_worker(int worker_idx)
+{
+    current_worker_idx = worker_idx;
+    while (true) {
+        std::function<void()> task;
+        if (pop_or_steal(worker_idx, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wait_mutex_);
+        wait_cond_.wait(lock, [this]() { return pending_task_num_.load() > 0; });
+    }
+}
+
+void ObTaskScheduler::parallel_for(int64_t tenant_id, int64_t task_count, int parallelism,
+                                   const std::function<void(int64_t)>& func)
+{
+    if (task_count <= 0) {
+        return;
+    }
+    int wanted = static_cast<int>(std::min<int64_t>(std::max(parallelism, 1), task_count)) - 1;
+    int helper_num = wanted > 0 ? acquire_threads(tenant_id, wanted) : 0;
+    if (helper_num == 0) {
+        for (int64_t i = 0; i < task_count; ++i) {
+            func(i);
+        }
+        return;
+    }
+
+    struct State {
+        const std::function<void(int64_t)>* func_;
+        int64_t task_count_;
+        std::atomic<int64_t> next_task_{0};
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        int running_{0};
+        bool closed_{false};
+
+        void run() {
+            for (int64_t i = next_task_.fetch_add(1); i < task_count_; i = next_task_.fetch_add(1)) {
+                (*func_)(i);
+            }
+        }
+    };
+    auto state = std::make_shared<State>();
+    state->func_ = &func;
+    state->task_count_ = task_count;
+
+    for (int i = 0; i < helper_num; ++i) {
+        std::function<void()> helper = [this, state, tenant_id]() {
+            {
+                // the caller does not wait for helpers started after it finished all tasks
+                std::lock_guard<std::mutex> lock(state->mutex_);
+                if (state->closed_) {
+                    release_threads(tenant_id, 1);
+                    return;
+                }
+                state->running_++;
+            }
+            state->run();
+            release_threads(tenant_id, 1);
+            std::lock_guard<std::mutex> lock(state->mutex_);
+            if (--state->running_ == 0) {
+                state->cond_.notify_all();
+            }
+        };
+        if (!dispatch(std::move(helper))) {
+            release_threads(tenant_id, helper_num - i);
+            break;
+        }
+    }
+    state->run();
+    std::unique_lock<std::mutex> lock(state->mutex_);
+    state->closed_ = true;
+    state->cond_.wait(lock, [&state]() { return state->running_ == 0; });
+}
+
+void ObTaskScheduler::submit(int64_t tenant_id, std::function<void()> task, std::function<void()> on_drop)
+{
+    auto background_task = std::make_shared<BackgroundTask>();
+    background_task->tenant_id_ = tenant_id;
+    background_task->task_ = std::move(task);
+    background_task->on_drop_ = std::move(on_drop);
+    {
+        std::lock_guard<std::mutex> lock(quota_mutex_);
+        background_tasks_.push_back(std::move(background_task));
+    }
+    start_background_tasks();
+}
+
+} // namespace obvectorlib
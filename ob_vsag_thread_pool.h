@@ -0,0 +1,92 @@
+#ifndef OB_VSAG_THREAD_POOL_H
+#define OB_VSAG_THREAD_POOL_H
+#include "ob_vsag_lib.h"
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace obvectorlib {
+
+/*
+ * Process wide scheduler shared by all index handlers. Tasks run on a work stealing
+ * pool whose threads are started on demand, at most max_threads of them run tasks of
+ * parallel_for at the same time, or on the executor installed by set_thread_pool.
+ * A tenant with a quota never occupies more threads than its quota. The calling
+ * thread of parallel_for always takes part, so nested or over quota calls still
+ * make progress.
+ */
+class ObTaskScheduler
+{
+public:
+  static const int64_t DEFAULT_TENANT_ID = 0;
+  static const int MAX_POOL_THREADS = 256;
+
+  static ObTaskScheduler& instance();
+
+  void set_max_threads(int thread_num);
+  int get_max_threads() const { return max_threads_.load(); }
+  void set_executor(TaskExecutor* executor);
+  void set_tenant_quota(int64_t tenant_id, int max_threads);
+  // threads tenant_id may occupy at the same time: max_threads capped by its quota, at least 1
+  int get_thread_limit(int64_t tenant_id);
+
+  // run func(0) ... func(task_count - 1) on at most parallelism threads, caller included
+  void parallel_for(int64_t tenant_id, int64_t task_count, int parallelism,
+                    const std::function<void(int64_t)>& func);
+  /*
+   * Run task in background on a thread charged to max_threads and to the quota of
+   * tenant_id. The task waits in a queue while all threads are taken. It is dropped
+   * when it can never get one (max_threads or the tenant quota is 0), on_drop is
+   * then called instead, from the calling thread or the one changing the limits.
+   */
+  void submit(int64_t tenant_id, std::function<void()> task, std::function<void()> on_drop);
+
+private:
+  struct BackgroundTask {
+    int64_t tenant_id_;
+    std::function<void()> task_;
+    std::function<void()> on_drop_;
+  };
+
+  struct Worker {
+    std::mutex mutex_;
+    std::deque<std::function<void()>> tasks_;
+  };
+
+  ObTaskScheduler();
+  ~ObTaskScheduler() = delete;
+
+  int acquire_threads(int64_t tenant_id, int wanted);
+  void release_threads(int64_t tenant_id, int count);
+  void start_background_tasks();
+  bool dispatch(std::function<void()>&& task);
+  bool pop_or_steal(int worker_idx, std::function<void()>& task);
+  void ensure_workers(int thread_num);
+  void run_worker(int worker_idx);
+
+  std::atomic<int> max_threads_;
+  std::atomic<int> started_thread_num_;
+  std::atomic<TaskExecutor*> executor_;
+  Worker workers_[MAX_POOL_THREADS];
+
+  std::mutex start_mutex_;
+  std::mutex wait_mutex_;
+  std::condition_variable wait_cond_;
+  std::atomic<int64_t> pending_task_num_;
+  std::atomic<uint64_t> next_worker_;
+
+  std::mutex quota_mutex_;
+  int used_threads_;
+  std::unordered_map<int64_t, int> tenant_quotas_;
+  std::unordered_map<int64_t, int> tenant_used_;
+  std::deque<std::shared_ptr<BackgroundTask>> background_tasks_;
+};
+
+} // namespace obvectorlib
+#endif // OB_VSAG_THREAD_POOL_H
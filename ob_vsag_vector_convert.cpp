@@ -0,0 +1,289 @@
+#include "ob_vsag_vector_convert.h"
+#include "ob_vsag_thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace obvectorlib {
+
+// rows converted and checked by one task of ingest_rows_to_float
+static const int64_t CONVERT_BLOCK_ROWS = 1024;
+
+static float half_to_float_ref(uint16_t h)
+{
+    const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t bits = 0;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa != 0) {
+        // subnormal half, normalize the mantissa
+        exponent = 113;
+        while ((mantissa & 0x400) == 0) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    } else {
+        bits = sign;
+    }
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static void half_to_float_ref(const uint16_t* src, int64_t count, float* dst)
+{
+    for (int64_t i = 0; i < count; ++i) {
+        dst[i] = half_to_float_ref(src[i]);
+    }
+}
+
+// bf16 is the upper half of an fp32
+static void bf16_to_float_ref(const uint16_t* src, int64_t count, float* dst)
+{
+    for (int64_t i = 0; i < count; ++i) {
+        uint32_t bits = static_cast<uint32_t>(src[i]) << 16;
+        memcpy(dst + i, &bits, sizeof(float));
+    }
+}
+
+static void int8_to_float_ref(const int8_t* src, int64_t count, float* dst)
+{
+    for (int64_t i = 0; i < count; ++i) {
+        dst[i] = static_cast<float>(src[i]);
+    }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx,f16c")))
+static void half_to_float_f16c(const uint16_t* src, int64_t count, float* dst)
+{
+    int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+    }
+    half_to_float_ref(src + i, count - i, dst + i);
+}
+
+__attribute__((target("avx2")))
+static void bf16_to_float_avx2(const uint16_t* src, int64_t count, float* dst)
+{
+    int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16)));
+    }
+    bf16_to_float_ref(src + i, count - i, dst + i);
+}
+
+__attribute__((target("avx2")))
+static void int8_to_float_avx2(const int8_t* src, int64_t count, float* dst)
+{
+    int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i wide = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(wide));
+    }
+    int8_to_float_ref(src + i, count - i, dst + i);
+}
+
+__attribute__((target("avx2,fma")))
+static bool check_row_avx2(const float* row, int dim, float& sqr_norm)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 sum = zero;
+    __m256 bad = zero;
+    int i = 0;
+    for (; i + 8 <= dim; i += 8) {
+        __m256 v = _mm256_loadu_ps(row + i);
+        // v - v is NaN only for NaN and Inf
+        bad = _mm256_or_ps(bad, _mm256_cmp_ps(_mm256_sub_ps(v, v), zero, _CMP_NEQ_UQ));
+        sum = _mm256_fmadd_ps(v, v, sum);
+    }
+    __m128 sum128 = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    sum128 = _mm_add_ps(sum128, _mm_movehl_ps(sum128, sum128));
+    sum128 = _mm_add_ss(sum128, _mm_movehdup_ps(sum128));
+    float tail = 0;
+    bool finite = _mm256_movemask_ps(bad) == 0;
+    for (; i < dim; ++i) {
+        finite = finite && std::isfinite(row[i]);
+        tail += row[i] * row[i];
+    }
+    sqr_norm = _mm_cvtss_f32(sum128) + tail;
+    return finite;
+}
+
+__attribute__((target("avx2")))
+static void scale_row_avx2(float* row, int dim, float scale)
+{
+    const __m256 factor = _mm256_set1_ps(scale);
+    int i = 0;
+    for (; i + 8 <= dim; i += 8) {
+        _mm256_storeu_ps(row + i, _mm256_mul_ps(_mm256_loadu_ps(row + i), factor));
+    }
+    for (; i < dim; ++i) {
+        row[i] *= scale;
+    }
+}
+#endif
+
+// true when row holds no NaN or Inf, sqr_norm is set to the squared l2 norm of row
+static bool check_row_ref(const float* row, int dim, float& sqr_norm)
+{
+    bool finite = true;
+    sqr_norm = 0;
+    for (int i = 0; i < dim; ++i) {
+        finite = finite && std::isfinite(row[i]);
+        sqr_norm += row[i] * row[i];
+    }
+    return finite;
+}
+
+static void scale_row_ref(float* row, int dim, float scale)
+{
+    for (int i = 0; i < dim; ++i) {
+        row[i] *= scale;
+    }
+}
+
+static bool has_f16c()
+{
+#if defined(__x86_64__)
+    return __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+#else
+    return false;
+#endif
+}
+
+static bool has_avx2()
+{
+#if defined(__x86_64__)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+static bool has_fma()
+{
+#if defined(__x86_64__)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+static const bool USE_F16C = has_f16c();
+static const bool USE_AVX2 = has_avx2();
+static const bool USE_FMA = has_fma();
+
+int64_t get_vector_type_size(VectorDataType type)
+{
+    switch (type) {
+        case FLOAT32_VECTOR:
+            return sizeof(float);
+        case FLOAT16_VECTOR:
+        case BFLOAT16_VECTOR:
+            return sizeof(uint16_t);
+        case INT8_VECTOR:
+            return sizeof(int8_t);
+        default:
+            return 0;
+    }
+}
+
+void convert_to_float(VectorDataType type, const void* src, int64_t count, float* dst)
+{
+    if (FLOAT32_VECTOR == type) {
+        memcpy(dst, src, count * sizeof(float));
+    } else if (FLOAT16_VECTOR == type) {
+#if defined(__x86_64__)
+        if (USE_F16C) {
+            half_to_float_f16c(static_cast<const uint16_t*>(src), count, dst);
+            return;
+        }
+#endif
+        half_to_float_ref(static_cast<const uint16_t*>(src), count, dst);
+    } else if (BFLOAT16_VECTOR == type) {
+#if defined(__x86_64__)
+        if (USE_AVX2) {
+            bf16_to_float_avx2(static_cast<const uint16_t*>(src), count, dst);
+            return;
+        }
+#endif
+        bf16_to_float_ref(static_cast<const uint16_t*>(src), count, dst);
+    } else if (INT8_VECTOR == type) {
+#if defined(__x86_64__)
+        if (USE_AVX2) {
+            int8_to_float_avx2(static_cast<const int8_t*>(src), count, dst);
+            return;
+        }
+#endif
+        int8_to_float_ref(static_cast<const int8_t*>(src), count, dst);
+    }
+}
+
+// drops or normalizes row in place following flags, returns true when the row is dropped
+static bool ingest_row(float* row, int dim, int flags)
+{
+    float sqr_norm = 0;
+    bool finite = true;
+#if defined(__x86_64__)
+    if (USE_FMA) {
+        finite = check_row_avx2(row, dim, sqr_norm);
+    } else
+#endif
+    {
+        finite = check_row_ref(row, dim, sqr_norm);
+    }
+    if ((flags & INGEST_VALIDATE) && !finite) {
+        return true;
+    } else if (flags & INGEST_NORMALIZE) {
+        // zero rows have no direction, NaN/Inf rows or rows whose squared norm overflows no finite norm
+        if (!(sqr_norm > 0) || !std::isfinite(sqr_norm)) {
+            return true;
+        }
+        const float scale = 1.0f / std::sqrt(sqr_norm);
+#if defined(__x86_64__)
+        if (USE_AVX2) {
+            scale_row_avx2(row, dim, scale);
+            return false;
+        }
+#endif
+        scale_row_ref(row, dim, scale);
+    }
+    return false;
+}
+
+int64_t ingest_rows_to_float(VectorDataType type, const void* src, int64_t rows, int dim, int flags,
+                             int64_t tenant_id, int thread_num, float* dst, uint8_t* rejected)
+{
+    const int64_t type_size = get_vector_type_size(type);
+    const int64_t block_count = (rows + CONVERT_BLOCK_ROWS - 1) / CONVERT_BLOCK_ROWS;
+    std::atomic<int64_t> rejected_count(0);
+    // each block is converted and checked while it is still in cache
+    ObTaskScheduler::instance().parallel_for(tenant_id, block_count, std::max(thread_num, 1), [&](int64_t block) {
+        const int64_t begin = block * CONVERT_BLOCK_ROWS;
+        const int64_t count = std::min(CONVERT_BLOCK_ROWS, rows - begin);
+        float* block_rows = dst + begin * dim;
+        convert_to_float(type, static_cast<const char*>(src) + begin * dim * type_size, count * dim, block_rows);
+        int64_t block_rejected = 0;
+        for (int64_t i = 0; i < count; ++i) {
+            rejected[begin + i] = flags != 0 && ingest_row(block_rows + i * dim, dim, flags);
+            block_rejected += rejected[begin + i];
+        }
+        rejected_count.fetch_add(block_rejected, std::memory_order_relaxed);
+    });
+    return rejected_count.load();
+}
+
+} // namespace obvectorlib
@@ -0,0 +1,24 @@
+#ifndef OB_VSAG_VECTOR_CONVERT_H
+#define OB_VSAG_VECTOR_CONVERT_H
+#include "ob_vsag_lib.h"
+#include <stdint.h>
+
+namespace obvectorlib {
+
+// bytes of one element of type, 0 for an unknown type
+int64_t get_vector_type_size(VectorDataType type);
+
+// dst[i] = src[i] widened to fp32 for count elements, with f16c/avx2 when the cpu has them
+void convert_to_float(VectorDataType type, const void* src, int64_t count, float* dst);
+
+/*
+ * convert_to_float of rows rows of dim elements followed by the ingest stage of flags (mask
+ * of IngestFlag) on each row, blocks of rows are processed on at most thread_num threads of
+ * tenant_id. rejected[i] is set to 1 for the rows to drop and 0 for the others, returns the
+ * number of rows to drop.
+ */
+int64_t ingest_rows_to_float(VectorDataType type, const void* src, int64_t rows, int dim, int flags,
+                             int64_t tenant_id, int thread_num, float* dst, uint8_t* rejected);
+
+} // namespace obvectorlib
+#endif // OB_VSAG_VECTOR_CONVERT_H